@@ -56,6 +56,8 @@ typedef struct av_t {
   int is_input;
   value interrupt_cb;
   int closed;
+  // Read by an Avdevice capture thread.
+  int capturing;
 
   // input
   // index of stream to pull frames from or -1
@@ -81,6 +83,8 @@ static inline av_t *Av_val(value v) {
   av_t *av = Av_base_val(v);
   if (av->closed)
     Fail("Container closed!");
+  if (av->capturing)
+    Fail("Container is being captured!");
   return av;
 }
 
@@ -172,6 +176,16 @@ AVFormatContext *ocaml_av_get_format_context(value *p_av) {
   return Av_val(*p_av)->format_context;
 }
 
+AVFormatContext *ocaml_av_start_capture(value *p_av) {
+  av_t *av = Av_val(*p_av);
+
+  av->capturing = 1;
+
+  return av->format_context;
+}
+
+void ocaml_av_stop_capture(value *p_av) { Av_base_val(*p_av)->capturing = 0; }
+
 CAMLprim value ocaml_av_container_options(value unit) {
   (void)unit;
   CAMLparam0();
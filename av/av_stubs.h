@@ -7,6 +7,11 @@
 
 AVFormatContext *ocaml_av_get_format_context(value *p_av);
 
+/* Hand an input container over to a capture thread, and back. In between,
+   every function taking the container fails. */
+AVFormatContext *ocaml_av_start_capture(value *p_av);
+void ocaml_av_stop_capture(value *p_av);
+
 #if LIBAVFORMAT_VERSION_INT <= AV_VERSION_INT(59, 0, 100)
 #define avioformat_const
 #else
@@ -1440,20 +1440,15 @@ CAMLprim value ocaml_avcodec_get_next_codec(value h) {
     CAMLreturn(Val_int(0));
   }
 
-  for (i = 0; i < AV_CODEC_ID_AUDIO_TAB_LEN; i++) {
-    if (codec->id == AV_CODEC_ID_AUDIO_TAB[i][1])
-      id = AV_CODEC_ID_AUDIO_TAB[i][0];
-  }
-
-  for (i = 0; i < AV_CODEC_ID_VIDEO_TAB_LEN; i++) {
-    if (codec->id == AV_CODEC_ID_VIDEO_TAB[i][1])
-      id = AV_CODEC_ID_VIDEO_TAB[i][0];
-  }
-
-  for (i = 0; i < AV_CODEC_ID_SUBTITLE_TAB_LEN; i++) {
-    if (codec->id == AV_CODEC_ID_SUBTITLE_TAB[i][1])
-      id = AV_CODEC_ID_SUBTITLE_TAB[i][0];
-  }
+  if ((i = ocaml_avutil_enum_find_c(&AV_CODEC_ID_SUBTITLE_TAB_ENUM,
+                                    codec->id)) >= 0)
+    id = AV_CODEC_ID_SUBTITLE_TAB[i][0];
+  else if ((i = ocaml_avutil_enum_find_c(&AV_CODEC_ID_VIDEO_TAB_ENUM,
+                                         codec->id)) >= 0)
+    id = AV_CODEC_ID_VIDEO_TAB[i][0];
+  else if ((i = ocaml_avutil_enum_find_c(&AV_CODEC_ID_AUDIO_TAB_ENUM,
+                                         codec->id)) >= 0)
+    id = AV_CODEC_ID_AUDIO_TAB[i][0];
 
   if (id == VALUE_NOT_FOUND)
     _id = Val_int(0);
@@ -111,3 +111,67 @@ module Dev_to_app = struct
     (message -> unit) -> _ container -> unit
     = "ocaml_avdevice_set_control_message_callback"
 end
+
+module Capture = struct
+  type capture
+  type t = { capture : capture; container : input container }
+
+  type stats = {
+    captured : int;
+    overruns : int;
+    queued : int;
+    latency_avg : float;
+    latency_max : float;
+  }
+
+  (* The capture thread uses both the capture and its container: running
+     captures are kept here until they are stopped. *)
+  let running = ref []
+  let running_m = Mutex.create ()
+
+  external start : int -> input container -> capture
+    = "ocaml_avdevice_capture_start"
+
+  let start ?(capacity = 64) container =
+    let t = { capture = start capacity container; container } in
+    Mutex.lock running_m;
+    running := t :: !running;
+    Mutex.unlock running_m;
+    t
+
+  external stop : capture -> input container -> unit
+    = "ocaml_avdevice_capture_stop"
+
+  let stop t =
+    stop t.capture t.container;
+    Mutex.lock running_m;
+    running := List.filter (fun t' -> t' != t) !running;
+    Mutex.unlock running_m
+
+  external read :
+    bool ->
+    capture ->
+    [ `Packet of Av.packet_result * Int64.t | `Eagain | `Eof ]
+    = "ocaml_avdevice_capture_read"
+
+  let read ?(block = false) { capture; _ } = read block capture
+
+  external now : unit -> Int64.t = "ocaml_avdevice_capture_clock"
+
+  external stats : capture -> int * int * int * int * int * int
+    = "ocaml_avdevice_capture_stats"
+
+  let stats { capture; _ } =
+    let captured, overruns, queued, reads, latency, latency_max =
+      stats capture
+    in
+    {
+      captured;
+      overruns;
+      queued;
+      latency_avg =
+        (if reads = 0 then 0.
+         else float latency /. float reads /. 1_000_000.);
+      latency_max = float latency_max /. 1_000_000.;
+    }
+end
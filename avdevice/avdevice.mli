@@ -111,3 +111,50 @@ module Dev_to_app : sig
       [callback] for [device] message reception. *)
   val set_control_message_callback : (message -> unit) -> _ container -> unit
 end
+
+(** Low-latency capture: a native thread reads an input device as fast as it
+    delivers into a bounded queue, so that a slow or busy application does not
+    make the device itself overrun. *)
+module Capture : sig
+  type t
+
+  type stats = {
+    captured : int;  (** Packets read from the device. *)
+    overruns : int;  (** Packets dropped because the queue was full. *)
+    queued : int;  (** Packets waiting to be read. *)
+    latency_avg : float;
+        (** Average time, in seconds, between capture and [read]. *)
+    latency_max : float;  (** Maximum of the same. *)
+  }
+
+  (** [Avdevice.Capture.start ?capacity device] starts reading [device] on a
+      native thread into a queue of [capacity] packets (default: [64]). When
+      the queue is full, the oldest packet is dropped. Until [stop] is called,
+      using [device] raises [Error (`Failure _)] and its interrupt callback is
+      not used. A capture must be stopped: until then, neither it nor
+      [device] is released. Raise Error if [device] is closed or already
+      captured, or if the thread cannot be started. *)
+  val start : ?capacity:int -> input container -> t
+
+  (** [Avdevice.Capture.read ?block capture] return the oldest queued packet
+      along with the time it was captured at, on the [now] clock. Return
+      [`Eagain] if the queue is empty, unless [block] is [true] (default:
+      [false]) in which case wait for a packet. Return [`Eof] once the device
+      has ended or the capture has been stopped and the queue is empty. Raise
+      Error if the device failed. *)
+  val read :
+    ?block:bool ->
+    t ->
+    [ `Packet of Av.packet_result * Int64.t | `Eagain | `Eof ]
+
+  (** Stop the capture thread and give [device] back. Queued packets can still
+      be read. Stopping twice has no effect. *)
+  val stop : t -> unit
+
+  (** Current time of the monotonic clock used to timestamp packets, in
+      microseconds. *)
+  val now : unit -> Int64.t
+
+  (** Capture statistics. *)
+  val stats : t -> stats
+end
@@ -1,3 +1,5 @@
+#include <pthread.h>
+
 #define CAML_NAME_SPACE 1
 
 #include <caml/alloc.h>
@@ -9,8 +11,10 @@
 #include <caml/threads.h>
 
 #include <libavdevice/avdevice.h>
+#include <libavutil/time.h>
 
 #include "av_stubs.h"
+#include "avcodec_stubs.h"
 #include "avutil_stubs.h"
 
 CAMLprim value ocaml_avdevice_init(value unit) {
@@ -244,3 +248,324 @@ CAMLprim value ocaml_avdevice_set_control_message_callback(
 
   CAMLreturn(Val_unit);
 }
+
+/***** Capture *****/
+
+/* A native thread reads the device into a ring of packets, each stamped
+   with the monotonic clock as soon as it is read. When the ring is full,
+   the oldest packet is dropped. Everything below [thread] is guarded by
+   [mutex].
+
+   Running captures are kept reachable from the OCaml side, along with their
+   container, until they are stopped: the thread is always joined by [stop]
+   and never seen running by the finalizer. */
+
+typedef struct {
+  AVPacket *packet;
+  // The container may be closed once the capture stops.
+  enum AVMediaType type;
+  int64_t time;
+} capture_entry_t;
+
+typedef struct {
+  AVFormatContext *format_context;
+  AVIOInterruptCB interrupt_callback;
+  pthread_t thread;
+  int running;
+  pthread_mutex_t mutex;
+  pthread_cond_t ready;
+  capture_entry_t *entries;
+  int capacity;
+  int head;
+  int len;
+  int stop;
+  int err;
+  int64_t captured;
+  int64_t overruns;
+  int64_t reads;
+  int64_t latency;
+  int64_t max_latency;
+} capture_t;
+
+#define Capture_val(v) (*(capture_t **)Data_custom_val(v))
+
+static int capture_interrupt(void *opaque) {
+  capture_t *capture = opaque;
+  int stop;
+
+  pthread_mutex_lock(&capture->mutex);
+  stop = capture->stop;
+  pthread_mutex_unlock(&capture->mutex);
+
+  return stop;
+}
+
+static void *capture_thread(void *opaque) {
+  capture_t *capture = opaque;
+  capture_entry_t *entry;
+  AVPacket *packet = NULL;
+  int64_t time;
+  int err;
+
+  for (;;) {
+    // Devices which do no I/O never call the interrupt callback.
+    if (capture_interrupt(capture)) {
+      err = AVERROR_EXIT;
+      break;
+    }
+
+    if (!packet && !(packet = av_packet_alloc())) {
+      err = AVERROR(ENOMEM);
+      break;
+    }
+
+    err = av_read_frame(capture->format_context, packet);
+    time = av_gettime_relative();
+
+    if (err == AVERROR(EAGAIN)) {
+      av_usleep(1000);
+      continue;
+    }
+
+    if (err < 0)
+      break;
+
+    pthread_mutex_lock(&capture->mutex);
+
+    if (capture->len == capture->capacity) {
+      av_packet_free(&capture->entries[capture->head].packet);
+      capture->head = (capture->head + 1) % capture->capacity;
+      capture->len--;
+      capture->overruns++;
+    }
+
+    entry = &capture->entries[(capture->head + capture->len) %
+                              capture->capacity];
+    entry->packet = packet;
+    entry->type = capture->format_context->streams[packet->stream_index]
+                      ->codecpar->codec_type;
+    entry->time = time;
+    capture->len++;
+    capture->captured++;
+    packet = NULL;
+
+    pthread_cond_signal(&capture->ready);
+    pthread_mutex_unlock(&capture->mutex);
+  }
+
+  av_packet_free(&packet);
+
+  pthread_mutex_lock(&capture->mutex);
+  capture->err = err;
+  pthread_cond_signal(&capture->ready);
+  pthread_mutex_unlock(&capture->mutex);
+
+  return NULL;
+}
+
+static void finalize_capture(value v) {
+  capture_t *capture = Capture_val(v);
+
+  for (; capture->len > 0; capture->len--) {
+    av_packet_free(&capture->entries[capture->head].packet);
+    capture->head = (capture->head + 1) % capture->capacity;
+  }
+
+  pthread_cond_destroy(&capture->ready);
+  pthread_mutex_destroy(&capture->mutex);
+  av_free(capture->entries);
+  av_free(capture);
+}
+
+static struct custom_operations capture_ops = {
+    "ocaml_avdevice_capture",   finalize_capture,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+CAMLprim value ocaml_avdevice_capture_start(value _capacity, value _av) {
+  CAMLparam2(_capacity, _av);
+  CAMLlocal1(ret);
+  AVFormatContext *format_context;
+  capture_t *capture;
+  int err;
+
+  if (Int_val(_capacity) < 1)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  capture = av_mallocz(sizeof(capture_t));
+  if (!capture)
+    caml_raise_out_of_memory();
+
+  capture->entries = av_malloc_array(Int_val(_capacity),
+                                     sizeof(capture_entry_t));
+  if (!capture->entries) {
+    av_free(capture);
+    caml_raise_out_of_memory();
+  }
+
+  capture->capacity = Int_val(_capacity);
+  pthread_mutex_init(&capture->mutex, NULL);
+  pthread_cond_init(&capture->ready, NULL);
+
+  ret = caml_alloc_custom(&capture_ops, sizeof(capture_t *), 0, 1);
+  Capture_val(ret) = capture;
+
+  // Raises if the container is closed or already captured.
+  format_context = ocaml_av_start_capture(&_av);
+  capture->format_context = format_context;
+
+  // The container's own interrupt callback would run OCaml code on the
+  // capture thread: it is set aside until the capture stops.
+  capture->interrupt_callback = format_context->interrupt_callback;
+  format_context->interrupt_callback.callback = capture_interrupt;
+  format_context->interrupt_callback.opaque = capture;
+
+  err = pthread_create(&capture->thread, NULL, capture_thread, capture);
+  if (err) {
+    format_context->interrupt_callback = capture->interrupt_callback;
+    ocaml_av_stop_capture(&_av);
+    ocaml_avutil_raise_error(AVERROR(err));
+  }
+  capture->running = 1;
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avdevice_capture_stop(value _capture, value _av) {
+  CAMLparam2(_capture, _av);
+  capture_t *capture = Capture_val(_capture);
+
+  if (!capture->running)
+    CAMLreturn(Val_unit);
+
+  // Before releasing the runtime, so that only one [stop] joins.
+  capture->running = 0;
+
+  pthread_mutex_lock(&capture->mutex);
+  capture->stop = 1;
+  pthread_mutex_unlock(&capture->mutex);
+
+  caml_release_runtime_system();
+  pthread_join(capture->thread, NULL);
+  caml_acquire_runtime_system();
+
+  capture->format_context->interrupt_callback = capture->interrupt_callback;
+  ocaml_av_stop_capture(&_av);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avdevice_capture_read(value _block, value _capture) {
+  CAMLparam2(_block, _capture);
+  CAMLlocal4(ret, packet_value, content, kind_value);
+  capture_t *capture = Capture_val(_capture);
+  capture_entry_t entry = {NULL, 0};
+  int64_t latency;
+  value kind;
+  int err;
+
+  for (;;) {
+    if (Bool_val(_block)) {
+      caml_release_runtime_system();
+      pthread_mutex_lock(&capture->mutex);
+      while (!capture->len && !capture->err)
+        pthread_cond_wait(&capture->ready, &capture->mutex);
+    } else
+      pthread_mutex_lock(&capture->mutex);
+
+    if (capture->len > 0) {
+      entry = capture->entries[capture->head];
+      capture->head = (capture->head + 1) % capture->capacity;
+      capture->len--;
+
+      latency = av_gettime_relative() - entry.time;
+      capture->reads++;
+      capture->latency += latency;
+      if (latency > capture->max_latency)
+        capture->max_latency = latency;
+    }
+    err = capture->err;
+    pthread_mutex_unlock(&capture->mutex);
+
+    if (Bool_val(_block))
+      caml_acquire_runtime_system();
+
+    if (!entry.packet) {
+      // Stopping is the end of the stream as far as readers go.
+      if (!err)
+        CAMLreturn(PVV_Eagain);
+      if (err == AVERROR_EOF || err == AVERROR_EXIT)
+        CAMLreturn(PVV_Eof);
+      ocaml_avutil_raise_error(err);
+    }
+
+    switch (entry.type) {
+    case AVMEDIA_TYPE_AUDIO:
+      kind = PVV_Audio_packet;
+      break;
+    case AVMEDIA_TYPE_VIDEO:
+      kind = PVV_Video_packet;
+      break;
+    case AVMEDIA_TYPE_DATA:
+      kind = PVV_Data_packet;
+      break;
+    case AVMEDIA_TYPE_SUBTITLE:
+      kind = PVV_Subtitle_packet;
+      break;
+    default:
+      av_packet_free(&entry.packet);
+      continue;
+    }
+
+    break;
+  }
+
+  kind_value = kind;
+  content = caml_alloc_tuple(2);
+  Store_field(content, 0, Val_int(entry.packet->stream_index));
+  Store_field(content, 1, value_of_ffmpeg_packet(&packet_value, entry.packet));
+
+  packet_value = caml_alloc_tuple(2);
+  Store_field(packet_value, 0, kind_value);
+  Store_field(packet_value, 1, content);
+
+  content = caml_alloc_tuple(2);
+  Store_field(content, 0, packet_value);
+  Store_field(content, 1, caml_copy_int64(entry.time));
+
+  ret = caml_alloc_tuple(2);
+  Store_field(ret, 0, PVV_Packet);
+  Store_field(ret, 1, content);
+
+  CAMLreturn(ret);
+}
+
+/* (captured, overruns, queued, reads, total latency, max latency) */
+CAMLprim value ocaml_avdevice_capture_stats(value _capture) {
+  CAMLparam1(_capture);
+  CAMLlocal1(ret);
+  capture_t *capture = Capture_val(_capture);
+  int64_t stats[6];
+  int i;
+
+  pthread_mutex_lock(&capture->mutex);
+  stats[0] = capture->captured;
+  stats[1] = capture->overruns;
+  stats[2] = capture->len;
+  stats[3] = capture->reads;
+  stats[4] = capture->latency;
+  stats[5] = capture->max_latency;
+  pthread_mutex_unlock(&capture->mutex);
+
+  ret = caml_alloc_tuple(6);
+  for (i = 0; i < 6; i++)
+    Store_field(ret, i, Val_int(stats[i]));
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avdevice_capture_clock(value unit) {
+  CAMLparam0();
+  CAMLreturn(caml_copy_int64(av_gettime_relative()));
+}
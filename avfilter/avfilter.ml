@@ -47,14 +47,99 @@ type 'a filter = {
 
 type 'a input = [ `Frame of 'a Avutil.frame | `Flush ] -> unit
 type 'a context = filter_ctx
-type 'a output = { context : 'a context; handler : unit -> 'a Avutil.frame }
+type 'a pulled = [ `Frame of 'a Avutil.frame | `Eagain | `Eof ]
+
+type slow_consumer = [ `Drop_oldest | `Drop_newest | `Block ]
+
+module Broadcast = struct
+  type broadcast
+  type 'a t = { graph : _config; broadcast : broadcast }
+  type 'a consumer = { source : 'a t; index : int }
+
+  external create : filter_ctx -> int -> int -> broadcast
+    = "ocaml_avfilter_broadcast_create"
+
+  let int_of_policy = function
+    | `Drop_oldest -> 0
+    | `Drop_newest -> 1
+    | `Block -> 2
+
+  let create ?(capacity = 8) ?(policy = `Drop_oldest) graph filter_ctx =
+    { graph; broadcast = create filter_ctx capacity (int_of_policy policy) }
+
+  external subscribe : broadcast -> int = "ocaml_avfilter_broadcast_subscribe"
+
+  let subscribe source = { source; index = subscribe source.broadcast }
+
+  external unsubscribe : broadcast -> int -> unit
+    = "ocaml_avfilter_broadcast_unsubscribe"
+
+  let unsubscribe { source; index } = unsubscribe source.broadcast index
+
+  external pump : _config -> broadcast -> [ `Eagain | `Eof ]
+    = "ocaml_avfilter_broadcast_pump"
+
+  let pump { graph; broadcast } = pump graph broadcast
+
+  external take : broadcast -> int -> 'a pulled
+    = "ocaml_avfilter_broadcast_take"
+
+  let take { source; index } = take source.broadcast index
+
+  external stats : broadcast -> int -> int * int
+    = "ocaml_avfilter_broadcast_stats"
+
+  let pending { source; index } = fst (stats source.broadcast index)
+  let dropped { source; index } = snd (stats source.broadcast index)
+end
+
+type 'a output = {
+  context : 'a context;
+  handler : unit -> 'a Avutil.frame;
+  pull : ?into:'a Avutil.frame -> unit -> 'a pulled;
+  drain :
+    ?into:'a Avutil.frame array ->
+    unit ->
+    'a Avutil.frame array * [ `Eagain | `Eof ];
+  broadcast :
+    ?capacity:int -> ?policy:slow_consumer -> unit -> 'a Broadcast.t;
+}
+
 type 'a entries = (string * 'a) list
 type inputs = ([ `Audio ] input entries, [ `Video ] input entries) av
 type outputs = ([ `Audio ] output entries, [ `Video ] output entries) av
 type t = (inputs, outputs) io
 
+type source_params
+
+(* Hidden last field of an attached filter. Emptied by [reconfigure], which
+   replaces the graph the filter was attached to. *)
+type attachment = { mutable live_ctx : filter_ctx option }
+
+(* What was done to a graph before launching it, in order to build it again:
+   links between attached filters are read back from the graph itself. *)
+type op =
+  | Attach of {
+      ctx : filter_ctx;
+      name : string;
+      filter : string;
+      args : string option;
+      nb_threads : int option;
+      thread_type : int option;
+      mutable params : source_params option;
+      handle : [ `Attached ] filter;
+    }
+  | Parse of {
+      inputs : (string * filter_ctx * int) array;
+      outputs : (string * filter_ctx * int) array;
+      filters : string;
+    }
+
 type config = {
-  c : _config;
+  mutable c : _config;
+  init_args : int * int * bool;
+  mutable ops : op list;
+  mutable links : (int * int * int * int) array;
   mutable names : string list;
   mutable video_inputs : filter_ctx entries;
   mutable audio_inputs : filter_ctx entries;
@@ -189,11 +274,21 @@ let find_opt name = List.find_opt (fun f -> f.name = name) filters
 let pad_name { pad_name; _ } = pad_name
 let filter_name { filter_name; _ } = filter_name
 
-external init : unit -> _config = "ocaml_avfilter_init"
+type thread_type = [ `None | `Slice ]
+
+(* AVFILTER_THREAD_SLICE, the only threading model lavfi has. *)
+let int_of_thread_type = function `None -> 0 | `Slice -> 1
+
+external init_graph : int -> int -> bool -> _config = "ocaml_avfilter_init"
 
-let init () =
+let init ?(nb_threads = 0) ?(thread_type = `Slice) ?(profile = false) () =
+  let init_args = (nb_threads, int_of_thread_type thread_type, profile) in
+  let nb_threads, thread_type, profile = init_args in
   {
-    c = init ();
+    c = init_graph nb_threads thread_type profile;
+    init_args;
+    ops = [];
+    links = [||];
     names = [];
     audio_inputs = [];
     video_inputs = [];
@@ -201,13 +296,32 @@ let init () =
     video_outputs = [];
   }
 
+type io_stats = {
+  io_name : string;
+  io_filter : string;
+  io_source : bool;
+  io_frames : int;
+  io_time : float;
+  io_failed_requests : int;
+}
+
+external profile : _config -> io_stats array = "ocaml_avfilter_profile"
+
+let profile { c; _ } = Array.to_list (profile c)
+
+external nb_threads : _config -> int = "ocaml_avfilter_nb_threads"
+
+let nb_threads { c; _ } = nb_threads c
+
 external create_filter :
   ?args:string ->
+  ?nb_threads:int ->
+  ?thread_type:int ->
   name:string ->
   string ->
   _config ->
   filter_ctx * ('a, 'b, 'c) pad array * ('a, 'b, 'c) pad array
-  = "ocaml_avfilter_create_filter"
+  = "ocaml_avfilter_create_filter_byte" "ocaml_avfilter_create_filter"
 
 let string_of_ground_arg = function
   | `String s -> s
@@ -236,8 +350,8 @@ let args_of_args filter_name = function
   | Some args -> Some (String.concat ":" (args_of_args filter_name [] args))
   | None -> None
 
-let attach_pad filter_ctx graph pad =
-  { pad with filter_ctx = Some filter_ctx; _config = Some graph.c }
+let attach_pad filter_ctx c pad =
+  { pad with filter_ctx = Some filter_ctx; _config = Some c }
 
 let append_io graph ~name filter_name filter_ctx =
   match filter_name with
@@ -252,17 +366,12 @@ let append_io graph ~name filter_name filter_ctx =
 
 (* This creates a record with a hidden field in the last position. *)
 external append_context :
-  [ `Unattached ] filter -> filter_ctx -> [ `Attached ] filter
+  [ `Unattached ] filter -> attachment -> [ `Attached ] filter
   = "ocaml_avfilter_append_context"
 
-let attach ?args ~name filter graph =
-  if List.mem name graph.names then raise Exists;
-  let args = args_of_args filter.name args in
-  let filter_ctx, inputs, outputs =
-    create_filter ?args ~name filter.name graph.c
-  in
+let attach_filter filter c filter_ctx inputs outputs =
   let io = { inputs = split_pads inputs; outputs = split_pads outputs } in
-  let f () = List.map (attach_pad filter_ctx graph) in
+  let f () = List.map (attach_pad filter_ctx c) in
   let inputs =
     { audio = (f ()) io.inputs.audio; video = (f ()) io.inputs.video }
   in
@@ -270,12 +379,45 @@ let attach ?args ~name filter graph =
     { audio = (f ()) io.outputs.audio; video = (f ()) io.outputs.video }
   in
   let io = { inputs; outputs } in
-  let filter = { filter with io } in
+  append_context { filter with io } { live_ctx = Some filter_ctx }
+
+let attach ?args ?nb_threads ?thread_type ~name filter graph =
+  if List.mem name graph.names then raise Exists;
+  let args = args_of_args filter.name args in
+  let thread_type = Option.map int_of_thread_type thread_type in
+  let filter_ctx, inputs, outputs =
+    create_filter ?args ?nb_threads ?thread_type ~name filter.name graph.c
+  in
+  let handle = attach_filter filter graph.c filter_ctx inputs outputs in
   graph.names <- name :: graph.names;
+  graph.ops <-
+    Attach
+      {
+        ctx = filter_ctx;
+        name;
+        filter = filter.name;
+        args;
+        nb_threads;
+        thread_type;
+        params = None;
+        handle;
+      }
+    :: graph.ops;
   append_io graph ~name filter.name filter_ctx;
-  append_context filter filter_ctx
-
-external link : filter_ctx -> int -> filter_ctx -> int -> unit
+  handle
+
+let attached_filter graph name =
+  match
+    List.find_map
+      (function
+        | Attach { name = name'; handle; _ } when name' = name -> Some handle
+        | _ -> None)
+      graph.ops
+  with
+    | Some handle -> handle
+    | None -> raise Not_found
+
+external link_filters : filter_ctx -> int -> filter_ctx -> int -> unit
   = "ocaml_avfilter_link"
 
 let get_some = function
@@ -283,7 +425,11 @@ let get_some = function
   | None -> failwith "ffmpeg API error: filter is not attached!"
 
 let link src dst =
-  link (get_some src.filter_ctx) src.idx (get_some dst.filter_ctx) dst.idx
+  link_filters
+    (get_some src.filter_ctx)
+    src.idx
+    (get_some dst.filter_ctx)
+    dst.idx
 
 type command_flag = [ `Fast ]
 
@@ -295,15 +441,25 @@ external process_command :
   flags:int -> cmd:string -> arg:string -> filter_ctx -> string
   = "ocaml_avfilter_process_commands"
 
-external get_context : [ `Attached ] filter -> filter_ctx
+external get_attachment : [ `Attached ] filter -> attachment
   = "ocaml_avfilter_get_content"
 
+let get_context filter =
+  match (get_attachment filter).live_ctx with
+    | Some filter_ctx -> filter_ctx
+    | None -> failwith "ffmpeg API error: filter graph was reconfigured!"
+
 let process_command ?(flags = []) ~cmd ?(arg = "") filter =
   let flags =
     List.fold_left (fun cur flag -> cur lor int_of_command_flag flag) 0 flags
   in
   process_command ~flags ~cmd ~arg (get_context filter)
 
+external filter_nb_threads : filter_ctx -> int
+  = "ocaml_avfilter_filter_nb_threads"
+
+let filter_nb_threads filter = filter_nb_threads (get_context filter)
+
 type ('a, 'b, 'c) parse_node = {
   node_name : string;
   node_args : args list option;
@@ -317,7 +473,7 @@ type ('a, 'b) parse_av =
 
 type 'a parse_io = (('a, [ `Input ]) parse_av, ('a, [ `Output ]) parse_av) io
 
-external parse :
+external parse_graph :
   inputs:(string * filter_ctx * int) array ->
   outputs:(string * filter_ctx * int) array ->
   string ->
@@ -342,7 +498,8 @@ let parse ({ inputs; outputs } : [ `Attached ] parse_io) filters graph =
     Array.of_list
       (List.map get_ctx outputs.audio @ List.map get_ctx outputs.video)
   in
-  parse ~inputs ~outputs filters graph.c
+  parse_graph ~inputs ~outputs filters graph.c;
+  graph.ops <- Parse { inputs; outputs; filters } :: graph.ops
 
 external config : _config -> unit = "ocaml_avfilter_config"
 
@@ -358,12 +515,75 @@ let write_frame config filter = function
   | `Frame frame -> write_frame config filter frame
   | `Flush -> write_eof_frame config filter
 
+type 'a source = { source_config : _config; source_ctx : filter_ctx }
+
+let sources graph =
+  let source (name, source_ctx) =
+    (name, { source_config = graph.c; source_ctx })
+  in
+  {
+    audio = List.map source graph.audio_inputs;
+    video = List.map source graph.video_inputs;
+  }
+
+external push_frame :
+  _config -> filter_ctx -> bool -> bool -> 'a Avutil.frame -> unit
+  = "ocaml_avfilter_push_frame"
+
+external push_frames :
+  _config -> filter_ctx -> bool -> bool -> 'a Avutil.frame array -> unit
+  = "ocaml_avfilter_push_frames"
+
+let push ?(check_format = true) ?(transfer = false)
+    { source_config; source_ctx } frame =
+  push_frame source_config source_ctx check_format transfer frame
+
+let push_all ?(check_format = true) ?(transfer = false)
+    { source_config; source_ctx } frames =
+  push_frames source_config source_ctx check_format transfer frames
+
 (* First argument is not used but here to make sure that _config is not GCed while
    using the filters. *)
 external get_frame : _config -> filter_ctx -> 'b Avutil.frame
   = "ocaml_avfilter_get_frame"
 
+external pull_frame :
+  _config -> filter_ctx -> 'b Avutil.frame option -> 'b pulled
+  = "ocaml_avfilter_pull_frame"
+
+external drain_frames :
+  _config ->
+  filter_ctx ->
+  'b Avutil.frame array ->
+  'b Avutil.frame array * [ `Eagain | `Eof ] = "ocaml_avfilter_drain_frames"
+
+(* [graph.c] is replaced by [reconfigure]: outputs keep the graph which owns
+   their [filter_ctx] alive. *)
+let output graph filter_ctx =
+  let c = graph.c in
+  {
+    context = filter_ctx;
+    handler = (fun () -> get_frame c filter_ctx);
+    pull = (fun ?into () -> pull_frame c filter_ctx into);
+    drain = (fun ?(into = [||]) () -> drain_frames c filter_ctx into);
+    broadcast =
+      (fun ?capacity ?policy () ->
+        Broadcast.create ?capacity ?policy c filter_ctx);
+  }
+
+external links : filter_ctx array -> (int * int * int * int) array
+  = "ocaml_avfilter_links"
+
+let attached ops =
+  Array.of_list
+    (List.rev
+       (List.filter_map
+          (function Attach { ctx; _ } -> Some ctx | Parse _ -> None)
+          ops))
+
 let launch graph =
+  (* Before [config] inserts its conversion filters. *)
+  graph.links <- links (attached graph.ops);
   config graph.c;
   let audio =
     List.map
@@ -378,32 +598,156 @@ let launch graph =
   let inputs = { audio; video } in
   let audio =
     List.map
-      (fun (name, filter_ctx) ->
-        ( name,
-          {
-            context = filter_ctx;
-            handler = (fun () -> get_frame graph.c filter_ctx);
-          } ))
+      (fun (name, filter_ctx) -> (name, output graph filter_ctx))
       graph.audio_outputs
   in
   let video =
     List.map
-      (fun (name, filter_ctx) ->
-        ( name,
-          {
-            context = filter_ctx;
-            handler = (fun () -> get_frame graph.c filter_ctx);
-          } ))
+      (fun (name, filter_ctx) -> (name, output graph filter_ctx))
       graph.video_outputs
   in
   let outputs = { audio; video } in
   { outputs; inputs }
 
+external source_parameters : _ Avutil.frame -> source_params
+  = "ocaml_avfilter_source_parameters"
+
+external set_source_parameters : filter_ctx -> source_params -> unit
+  = "ocaml_avfilter_set_source_parameters"
+
+(* A fresh, unlaunched graph built from what was recorded of [graph]. *)
+let copy graph =
+  let nb_threads, thread_type, profile = graph.init_args in
+  let c = init_graph nb_threads thread_type profile in
+  let ctxs = ref [] in
+  let ctx old = List.assq old !ctxs in
+  let ops =
+    List.rev_map
+      (function
+        | Attach
+            {
+              ctx = old;
+              name;
+              filter;
+              args;
+              nb_threads;
+              thread_type;
+              params;
+              _;
+            } ->
+            let ctx, inputs, outputs =
+              create_filter ?args ?nb_threads ?thread_type ~name filter c
+            in
+            Option.iter (set_source_parameters ctx) params;
+            ctxs := (old, ctx) :: !ctxs;
+            let handle = attach_filter (find filter) c ctx inputs outputs in
+            Attach
+              {
+                ctx;
+                name;
+                filter;
+                args;
+                nb_threads;
+                thread_type;
+                params;
+                handle;
+              }
+        | Parse { inputs; outputs; filters } ->
+            let map =
+              Array.map (fun (name, old, idx) -> (name, ctx old, idx))
+            in
+            let inputs = map inputs and outputs = map outputs in
+            parse_graph ~inputs ~outputs filters c;
+            Parse { inputs; outputs; filters })
+      (List.rev graph.ops)
+  in
+  let filters = attached ops in
+  Array.iter
+    (fun (src, src_pad, dst, dst_pad) ->
+      link_filters filters.(src) src_pad filters.(dst) dst_pad)
+    graph.links;
+  let map = List.map (fun (name, old) -> (name, ctx old)) in
+  {
+    graph with
+    c;
+    ops;
+    audio_inputs = map graph.audio_inputs;
+    video_inputs = map graph.video_inputs;
+    audio_outputs = map graph.audio_outputs;
+    video_outputs = map graph.video_outputs;
+  }
+
+let reconfigure ?(audio = []) ?(video = []) graph =
+  let copy = copy graph in
+  let set_params sources (name, frame) =
+    let source = List.assoc name sources in
+    List.iter
+      (function
+        | Attach op when op.ctx == source ->
+            let params = source_parameters frame in
+            set_source_parameters source params;
+            op.params <- Some params
+        | _ -> ())
+      copy.ops
+  in
+  List.iter (set_params copy.audio_inputs) audio;
+  List.iter (set_params copy.video_inputs) video;
+  List.iter
+    (function
+      | Attach { handle; _ } -> (get_attachment handle).live_ctx <- None
+      | Parse _ -> ())
+    graph.ops;
+  graph.c <- copy.c;
+  graph.ops <- copy.ops;
+  graph.audio_inputs <- copy.audio_inputs;
+  graph.video_inputs <- copy.video_inputs;
+  graph.audio_outputs <- copy.audio_outputs;
+  graph.video_outputs <- copy.video_outputs;
+  launch graph
+
+module Template = struct
+  type template = {
+    graph : config;
+    pool : (config * t) Queue.t;
+    pool_m : Mutex.t;
+  }
+
+  type t = template
+
+  let create ?nb_threads ?thread_type ?profile build =
+    let graph = init ?nb_threads ?thread_type ?profile () in
+    build graph;
+    (* Launching checks the description. This graph is only ever copied. *)
+    ignore (launch graph);
+    { graph; pool = Queue.create (); pool_m = Mutex.create () }
+
+  let build { graph; _ } =
+    let graph = copy graph in
+    (graph, launch graph)
+
+  let locked { pool_m; _ } f =
+    Mutex.lock pool_m;
+    Fun.protect ~finally:(fun () -> Mutex.unlock pool_m) f
+
+  let prepare template n =
+    while locked template (fun () -> Queue.length template.pool) < n do
+      let instance = build template in
+      locked template (fun () -> Queue.add instance template.pool)
+    done
+
+  let instantiate template =
+    match locked template (fun () -> Queue.take_opt template.pool) with
+      | Some instance -> instance
+      | None -> build template
+
+  let prepared template = locked template (fun () -> Queue.length template.pool)
+end
+
 module Utils = struct
   type audio_converter = {
     time_base : Avutil.rational;
     filter_in : [ `Frame of Avutil.audio Avutil.frame | `Flush ] -> unit;
-    filter_out : unit -> Avutil.audio Avutil.frame;
+    filter_out : unit -> Avutil.audio pulled;
   }
 
   type audio_params = {
@@ -494,17 +838,24 @@ module Utils = struct
         | Some frame_size -> set_frame_size filter_out.context frame_size
     in
     let time_base = time_base filter_out.context in
-    { time_base; filter_in; filter_out = filter_out.handler }
+    {
+      time_base;
+      filter_in;
+      filter_out = (fun () -> filter_out.pull ());
+    }
 
   let convert_audio { filter_in; filter_out; _ } cb frame =
     let rec flush () =
-      try
-        cb (filter_out ());
-        flush ()
-      with Avutil.Error `Eagain -> ()
+      match filter_out () with
+        | `Frame frame ->
+            cb frame;
+            flush ()
+        | `Eagain -> ()
+        | `Eof when frame = `Flush -> ()
+        | `Eof -> raise (Avutil.Error `Eof)
     in
     filter_in frame;
-    try flush () with Avutil.Error `Eof when frame = `Flush -> ()
+    flush ()
 
   let time_base { time_base; _ } = time_base
 end
@@ -39,7 +39,65 @@ type 'a filter = {
 
 type 'a input = [ `Frame of 'a frame | `Flush ] -> unit
 type 'a context
-type 'a output = { context : 'a context; handler : unit -> 'a frame }
+type 'a pulled = [ `Frame of 'a frame | `Eagain | `Eof ]
+
+(** What a broadcast does with a frame for a consumer whose queue is full:
+    drop the consumer's oldest queued frame, drop the new frame for that
+    consumer, or wait for the consumer to take a frame. *)
+type slow_consumer = [ `Drop_oldest | `Drop_newest | `Block ]
+
+(** Fan-out of one sink to several consumers. Each consumer gets a reference
+    to every frame, not a copy, in a queue of its own. Consumers may take
+    frames from other threads than the one pumping. *)
+module Broadcast : sig
+  type 'a t
+  type 'a consumer
+
+  (** A new consumer, which receives the frames pumped from now on. *)
+  val subscribe : 'a t -> 'a consumer
+
+  (** Stop queueing frames for a consumer and release its queued ones. *)
+  val unsubscribe : _ consumer -> unit
+
+  (** Pull every available frame from the sink into the consumers' queues.
+      Returns the state of the sink once drained. With the [`Block] policy,
+      this waits for full consumers to take frames: these must do so from
+      another thread. *)
+  val pump : _ t -> [ `Eagain | `Eof ]
+
+  (** Next frame queued for a consumer. [`Eagain] means none is queued yet,
+      [`Eof] that none is queued and the sink has ended. *)
+  val take : 'a consumer -> 'a pulled
+
+  (** Number of frames queued for a consumer. *)
+  val pending : _ consumer -> int
+
+  (** Number of frames a consumer missed because its queue was full. *)
+  val dropped : _ consumer -> int
+end
+
+(** A sink of a launched graph. [handler] returns the next frame and raises
+    [Error `Eagain] or [Error `Eof] when there is none. [pull] returns those
+    states instead of raising. [drain] returns all available frames and the
+    state that ended the drain.
+
+    Passing [~into] pulls into the given frames instead of allocating new
+    ones. Their previous content is released first, so that its buffers can
+    be reused: a frame into which nothing is pulled is left empty. [drain]
+    fills the [into] frames in order and then allocates new frames for any
+    extra output. Raises Error if the same frame is given twice.
+
+    [broadcast] takes over the sink for fan-out, with queues of [capacity]
+    frames per consumer, 8 by default. [policy] defaults to [`Drop_oldest]. *)
+type 'a output = {
+  context : 'a context;
+  handler : unit -> 'a frame;
+  pull : ?into:'a frame -> unit -> 'a pulled;
+  drain : ?into:'a frame array -> unit -> 'a frame array * [ `Eagain | `Eof ];
+  broadcast :
+    ?capacity:int -> ?policy:slow_consumer -> unit -> 'a Broadcast.t;
+}
+
 type 'a entries = (string * 'a) list
 type inputs = ([ `Audio ] input entries, [ `Video ] input entries) av
 type outputs = ([ `Audio ] output entries, [ `Video ] output entries) av
@@ -87,29 +145,84 @@ val pad_name : _ pad -> string
 (** Name of the filter of which this pad is an instance *)
 val filter_name : _ pad -> string
 
-(** Initiate a filter graph configuration. *)
-val init : unit -> config
+(** Threading allowed in a graph or filter. Only filters with the
+    [`Slice_threads] flag make use of [`Slice]. *)
+type thread_type = [ `None | `Slice ]
+
+(** Initiate a filter graph configuration. [nb_threads] is the size of the
+    graph's thread pool, [0] (the default) picks one from the number of CPUs.
+    [thread_type] defaults to [`Slice]. With [~profile:true], frames and time
+    are counted at the graph's buffer sources and sinks, see [profile]. *)
+val init :
+  ?nb_threads:int ->
+  ?thread_type:thread_type ->
+  ?profile:bool ->
+  unit ->
+  config
+
+(** Counters of a buffer source or sink. *)
+type io_stats = {
+  io_name : string;  (** Instance name. *)
+  io_filter : string;
+      (** [buffer], [abuffer], [buffersink] or [abuffersink]. *)
+  io_source : bool;
+  io_frames : int;  (** Frames pushed to a source or pulled from a sink. *)
+  io_time : float;
+      (** Seconds spent in the graph while pushing or pulling, which includes
+          running the filters the frames went through. *)
+  io_failed_requests : int;
+      (** Times a sink asked a source for a frame it did not have, always [0]
+          for sinks. A starving input shows here. *)
+}
+
+(** Counters of every buffer source and sink of the graph. [io_frames] and
+    [io_time] stay at [0] unless the graph was created with [~profile:true].
+    Comparing the time spent pulling from each sink shows which branch of a
+    graph is slow. libavfilter keeps the counters and queues of the links
+    between its filters private. *)
+val profile : config -> io_stats list
+
+(** Size of the graph's thread pool. Automatic sizing is only resolved once
+    the first filter is attached: until then this returns the requested
+    value. *)
+val nb_threads : config -> int
 
 (** Attach a filter to a filter graph configuration. Raises [Exists] if there is
     already a filter by that name in the graph. Number of inputs or outputs can
     change from the filter's specifications, in particular if the filter has the
-    [`Dynamic_input] or [`Dynamic_output] flag set. *)
+    [`Dynamic_input] or [`Dynamic_output] flag set. [nb_threads] caps the
+    number of the graph's threads used by this filter, [thread_type] can
+    disable slice threading for it. *)
 val attach :
   ?args:args list ->
+  ?nb_threads:int ->
+  ?thread_type:thread_type ->
   name:string ->
   [ `Unattached ] filter ->
   config ->
   [ `Attached ] filter
 
+(** The filter attached under [name] to a graph configuration, as rebuilt by
+    the latest [reconfigure] or [Template] copy. Filters created by [parse]
+    are not listed. Raises [Not_found] if there is none. *)
+val attached_filter : config -> string -> [ `Attached ] filter
+
 (** Link two filter pads. *)
 val link :
   ([ `Attached ], 'a, [ `Output ]) pad ->
   ([ `Attached ], 'a, [ `Input ]) pad ->
   unit
 
+(** Number of threads an attached filter actually runs on: [1] when it does
+    not do slice threading or was refused it. Raises [Failure] for a filter
+    whose graph was since reconfigured. *)
+val filter_nb_threads : [ `Attached ] filter -> int
+
 type command_flag = [ `Fast ]
 
-(** Send a command to a attached filter pad. *)
+(** Send a command to a attached filter pad. Raises [Failure] for a filter
+    whose graph was since reconfigured: get the new one with
+    [attached_filter]. *)
 val process_command :
   ?flags:command_flag list ->
   cmd:string ->
@@ -137,6 +250,75 @@ val parse : [ `Attached ] parse_io -> string -> config -> unit
     return its outputs and outputs. *)
 val launch : config -> t
 
+(** Build a launched graph again with new input formats, and launch it. The
+    new graph has the same filters, options and links, and the same threading
+    and profiling settings. [audio] and [video] map input names to a frame in
+    the new format, whose parameters are set on that buffer source. These
+    parameters are kept for later reconfigurations. Everything obtained
+    before from [launch], [sources] or [attach] refers to the previous graph,
+    which is kept alive while any of it is, and must be replaced: filters
+    from [attach] can no longer be used and are found again with
+    [attached_filter]. Commands sent with [process_command] are not
+    replayed. Raises [Not_found] for an
+    unknown input name. *)
+val reconfigure :
+  ?audio:(string * audio frame) list ->
+  ?video:(string * video frame) list ->
+  config ->
+  t
+
+(** A buffer input of a graph, for pushing frames with more control than its
+    [input] function. *)
+type 'a source
+
+(** The graph's buffer inputs, named as in its [inputs]. Frames can only be
+    pushed once the graph is launched: before that, pushing raises
+    [Error (`Failure _)]. *)
+val sources :
+  config -> ([ `Audio ] source entries, [ `Video ] source entries) av
+
+(** Push a frame to a source. With [~check_format:false], the frame is not
+    compared against the source's parameters: it must match them. With
+    [~transfer:true], the frame's data is handed over to the graph instead
+    of being referenced, and the frame is left empty. Pushing an empty frame
+    raises [Error]. Defaults are [check_format = true] and
+    [transfer = false], which behave like the graph's [input] function. *)
+val push : ?check_format:bool -> ?transfer:bool -> 'a source -> 'a frame -> unit
+
+(** Push frames in order in one call. Nothing is pushed when the graph is not
+    launched or one of the frames is empty. On other errors, the frames
+    before the failing one have been pushed. *)
+val push_all :
+  ?check_format:bool -> ?transfer:bool -> 'a source -> 'a frame array -> unit
+
+(** Graphs built repeatedly from the same description. *)
+module Template : sig
+  type graph := t
+  type t
+
+  (** Build a graph with [build], which attaches, parses and links filters
+      on the given config, and check it by launching it. Arguments are those
+      of [init]. *)
+  val create :
+    ?nb_threads:int ->
+    ?thread_type:thread_type ->
+    ?profile:bool ->
+    (config -> unit) ->
+    t
+
+  (** A launched copy of the template's graph, with the same filters, options
+      and links. It is taken from the prepared ones when there are any. *)
+  val instantiate : t -> config * graph
+
+  (** Build copies ahead of time, so that there are [n] prepared ones, for
+      instance between jobs. Filter graphs cannot be reset once used, so
+      prepared graphs are always fresh ones. *)
+  val prepare : t -> int -> unit
+
+  (** Number of prepared copies. *)
+  val prepared : t -> int
+end
+
 module Utils : sig
   type audio_converter
 
@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <string.h>
 
 #define CAML_NAME_SPACE 1
@@ -15,6 +16,7 @@
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 #include <libavutil/mem.h>
+#include <libavutil/time.h>
 
 #define AvFilterContext_val(v) (*(AVFilterContext **)Data_abstract_val(v))
 
@@ -140,8 +142,66 @@ CAMLprim value ocaml_avfilter_get_all_filters(value unit) {
 
 #define Filter_graph_val(v) (*(AVFilterGraph **)Data_custom_val(v))
 
+/* Profiling: when enabled, the graph's opaque pointer holds one entry per
+   buffer source or sink used so far, counting the frames which went through
+   it and the time spent in libavfilter doing so. The counters of the links
+   between filters are private to libavfilter. */
+typedef struct {
+  AVFilterContext *filter;
+  int64_t frames;
+  int64_t time;
+} profile_entry_t;
+
+typedef struct {
+  int len;
+  profile_entry_t *entries;
+} profile_t;
+
+static int64_t profile_start(AVFilterContext *filter_ctx) {
+  return filter_ctx->graph->opaque ? av_gettime_relative() : 0;
+}
+
+static profile_entry_t *profile_entry(profile_t *profile,
+                                      AVFilterContext *filter_ctx) {
+  profile_entry_t *entries;
+  int i;
+
+  for (i = 0; i < profile->len; i++)
+    if (profile->entries[i].filter == filter_ctx)
+      return &profile->entries[i];
+
+  entries = av_realloc_array(profile->entries, i + 1, sizeof(*entries));
+  if (!entries)
+    return NULL;
+
+  entries[i] = (profile_entry_t){filter_ctx, 0, 0};
+  profile->entries = entries;
+  profile->len++;
+
+  return &entries[i];
+}
+
+static void profile_end(AVFilterContext *filter_ctx, int frames,
+                        int64_t start) {
+  profile_t *profile = filter_ctx->graph->opaque;
+  profile_entry_t *entry;
+
+  if (!profile || !(entry = profile_entry(profile, filter_ctx)))
+    return;
+
+  entry->frames += frames;
+  entry->time += av_gettime_relative() - start;
+}
+
 static void finalize_filter_graph(value v) {
   AVFilterGraph *graph = Filter_graph_val(v);
+  profile_t *profile = graph->opaque;
+
+  if (profile) {
+    av_freep(&profile->entries);
+    av_freep(&graph->opaque);
+  }
+
   avfilter_graph_free(&graph);
 }
 
@@ -151,15 +211,25 @@ static struct custom_operations filter_graph_ops = {
     custom_serialize_default,      custom_deserialize_default,
     custom_compare_ext_default,    custom_fixed_length_default};
 
-CAMLprim value ocaml_avfilter_init(value unit) {
-  (void)unit;
-  CAMLparam0();
+CAMLprim value ocaml_avfilter_init(value _nb_threads, value _thread_type,
+                                   value _profile) {
+  CAMLparam3(_nb_threads, _thread_type, _profile);
   CAMLlocal1(ret);
   AVFilterGraph *graph = avfilter_graph_alloc();
 
   if (!graph)
     caml_raise_out_of_memory();
 
+  if (Bool_val(_profile) && !(graph->opaque = av_mallocz(sizeof(profile_t)))) {
+    avfilter_graph_free(&graph);
+    caml_raise_out_of_memory();
+  }
+
+  // The graph's thread pool is started with its first filter: these must be
+  // set before anything is attached.
+  graph->nb_threads = Int_val(_nb_threads);
+  graph->thread_type = Int_val(_thread_type);
+
   ret = caml_alloc_custom(&filter_graph_ops, sizeof(AVFilterGraph *), 1, 0);
 
   Filter_graph_val(ret) = graph;
@@ -167,9 +237,17 @@ CAMLprim value ocaml_avfilter_init(value unit) {
   CAMLreturn(ret);
 }
 
-CAMLprim value ocaml_avfilter_create_filter(value _args, value _instance_name,
-                                            value _name, value _graph) {
-  CAMLparam4(_instance_name, _args, _name, _graph);
+CAMLprim value ocaml_avfilter_nb_threads(value _graph) {
+  CAMLparam1(_graph);
+  CAMLreturn(Val_int(Filter_graph_val(_graph)->nb_threads));
+}
+
+CAMLprim value ocaml_avfilter_create_filter(value _args, value _nb_threads,
+                                            value _thread_type,
+                                            value _instance_name, value _name,
+                                            value _graph) {
+  CAMLparam5(_instance_name, _args, _nb_threads, _thread_type, _name);
+  CAMLxparam1(_graph);
   CAMLlocal2(ret, tmp);
 
   char *name = NULL;
@@ -198,8 +276,20 @@ CAMLprim value ocaml_avfilter_create_filter(value _args, value _instance_name,
     }
   }
 
+  // Same as avfilter_graph_create_filter, with the filter's threading set
+  // between allocation and initialisation.
   caml_release_runtime_system();
-  err = avfilter_graph_create_filter(&context, filter, name, args, NULL, graph);
+  context = avfilter_graph_alloc_filter(graph, filter, name);
+  if (context) {
+    if (_nb_threads != Val_none)
+      context->nb_threads = Int_val(Some_val(_nb_threads));
+    if (_thread_type != Val_none)
+      context->thread_type = Int_val(Some_val(_thread_type));
+    err = avfilter_init_str(context, args);
+    if (err < 0)
+      avfilter_free(context);
+  } else
+    err = AVERROR(ENOMEM);
   caml_acquire_runtime_system();
 
   if (name)
@@ -222,6 +312,27 @@ CAMLprim value ocaml_avfilter_create_filter(value _args, value _instance_name,
   CAMLreturn(ret);
 }
 
+CAMLprim value ocaml_avfilter_create_filter_byte(value *argv, int argn) {
+  (void)argn;
+  return ocaml_avfilter_create_filter(argv[0], argv[1], argv[2], argv[3],
+                                      argv[4], argv[5]);
+}
+
+// Mirrors ff_filter_get_nb_threads, which is private: a filter that does not
+// do slice threading, or was refused it at init, runs on one thread.
+CAMLprim value ocaml_avfilter_filter_nb_threads(value _filter) {
+  CAMLparam1(_filter);
+  AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  int nb_threads = filter_ctx->graph->nb_threads;
+
+  if (!(filter_ctx->thread_type & AVFILTER_THREAD_SLICE))
+    nb_threads = 1;
+  else if (filter_ctx->nb_threads > 0)
+    nb_threads = FFMIN(filter_ctx->nb_threads, nb_threads);
+
+  CAMLreturn(Val_int(FFMAX(nb_threads, 1)));
+}
+
 static void append_avfilter_in_out(AVFilterInOut **filter, char *name,
                                    AVFilterContext *filter_ctx, int pad_idx) {
   AVFilterInOut *cur = *filter;
@@ -381,6 +492,114 @@ CAMLprim value ocaml_avfilter_link(value _src, value _srcpad, value _dst,
   CAMLreturn(Val_unit);
 }
 
+/* Links between [_filters] as (source index, source pad, destination index,
+   destination pad), indices being positions in [_filters]. Links to other
+   filters are left out. */
+CAMLprim value ocaml_avfilter_links(value _filters) {
+  CAMLparam1(_filters);
+  CAMLlocal2(ret, link_value);
+  int i, j, k, l, len = Wosize_val(_filters), nb_links = 0;
+  AVFilterContext *src, *dst;
+  AVFilterLink *link;
+
+  // First pass counts, second pass fills.
+  for (l = 0; l < 2; l++) {
+    if (l)
+      ret = caml_alloc_tuple(nb_links);
+    nb_links = 0;
+
+    for (i = 0; i < len; i++) {
+      src = AvFilterContext_val(Field(_filters, i));
+      for (j = 0; j < (int)src->nb_outputs; j++) {
+        if (!(link = src->outputs[j]))
+          continue;
+
+        dst = link->dst;
+        for (k = 0; k < len && AvFilterContext_val(Field(_filters, k)) != dst;
+             k++)
+          ;
+        if (k == len)
+          continue;
+
+        if (l) {
+          link_value = caml_alloc_tuple(4);
+          Store_field(link_value, 0, Val_int(i));
+          Store_field(link_value, 1, Val_int(j));
+          Store_field(link_value, 2, Val_int(k));
+          // AVFilterPad is opaque: find the pad index from the link.
+          for (k = 0; dst->inputs[k] != link; k++)
+            ;
+          Store_field(link_value, 3, Val_int(k));
+          Store_field(ret, nb_links, link_value);
+        }
+        nb_links++;
+      }
+    }
+  }
+
+  CAMLreturn(ret);
+}
+
+#define Source_parameters_val(v)                                               \
+  (*(AVBufferSrcParameters **)Data_custom_val(v))
+
+static void finalize_source_parameters(value v) {
+  AVBufferSrcParameters *par = Source_parameters_val(v);
+
+  av_buffer_unref(&par->hw_frames_ctx);
+  av_channel_layout_uninit(&par->ch_layout);
+  av_free(par);
+}
+
+static struct custom_operations source_parameters_ops = {
+    "ocaml_avfilter_source_parameters", finalize_source_parameters,
+    custom_compare_default,             custom_hash_default,
+    custom_serialize_default,           custom_deserialize_default,
+    custom_compare_ext_default,         custom_fixed_length_default};
+
+/* The parameters a buffer source needs to accept [_frame]. Unset ones, such
+   as the sample rate of a video frame, are left alone when applied. */
+CAMLprim value ocaml_avfilter_source_parameters(value _frame) {
+  CAMLparam1(_frame);
+  CAMLlocal1(ret);
+  AVFrame *frame = Frame_val(_frame);
+  AVBufferSrcParameters *par = av_buffersrc_parameters_alloc();
+
+  if (!par)
+    caml_raise_out_of_memory();
+
+  ret = caml_alloc_custom(&source_parameters_ops,
+                          sizeof(AVBufferSrcParameters *), 0, 1);
+  Source_parameters_val(ret) = par;
+
+  par->format = frame->format;
+  par->width = frame->width;
+  par->height = frame->height;
+  par->sample_aspect_ratio = frame->sample_aspect_ratio;
+  par->sample_rate = frame->sample_rate;
+
+  if (frame->hw_frames_ctx &&
+      !(par->hw_frames_ctx = av_buffer_ref(frame->hw_frames_ctx)))
+    caml_raise_out_of_memory();
+
+  if (av_channel_layout_copy(&par->ch_layout, &frame->ch_layout) < 0)
+    caml_raise_out_of_memory();
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avfilter_set_source_parameters(value _filter, value _par) {
+  CAMLparam2(_filter, _par);
+
+  int err = av_buffersrc_parameters_set(AvFilterContext_val(_filter),
+                                        Source_parameters_val(_par));
+
+  if (err < 0)
+    ocaml_avutil_raise_error(err);
+
+  CAMLreturn(Val_unit);
+}
+
 CAMLprim value ocaml_avfilter_buffersink_get_time_base(value _src) {
   CAMLparam1(_src);
   CAMLlocal1(ret);
@@ -521,11 +740,106 @@ CAMLprim value ocaml_avfilter_write_frame(value _config, value _filter,
                                           value _frame) {
   CAMLparam3(_config, _filter, _frame);
   AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  int64_t start = profile_start(filter_ctx);
 
   caml_release_runtime_system();
   int err = av_buffersrc_write_frame(filter_ctx, Frame_val(_frame));
   caml_acquire_runtime_system();
 
+  profile_end(filter_ctx, err >= 0, start);
+
+  if (err < 0)
+    ocaml_avutil_raise_error(err);
+
+  CAMLreturn(Val_unit);
+}
+
+static int push_flags(value _check_format, value _transfer) {
+  int flags = 0;
+
+  if (!Bool_val(_check_format))
+    flags |= AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT;
+
+  // Without KEEP_REF, buffersrc moves the frame's references into the graph
+  // and leaves the frame blank.
+  if (!Bool_val(_transfer))
+    flags |= AV_BUFFERSRC_FLAG_KEEP_REF;
+
+  return flags;
+}
+
+/* Sources can be obtained before the graph is launched, when their output
+   link has no format yet. Frames emptied by a transfer carry no data. */
+static void check_push(AVFilterContext *filter_ctx, AVFrame *frame) {
+  if (!filter_ctx->outputs[0] || filter_ctx->outputs[0]->format < 0)
+    Fail("Graph is not launched");
+
+  if (!frame->buf[0])
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+}
+
+CAMLprim value ocaml_avfilter_push_frame(value _config, value _filter,
+                                         value _check_format, value _transfer,
+                                         value _frame) {
+  CAMLparam5(_config, _filter, _check_format, _transfer, _frame);
+  AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  AVFrame *frame = Frame_val(_frame);
+  int flags = push_flags(_check_format, _transfer);
+  int64_t start;
+
+  check_push(filter_ctx, frame);
+
+  start = profile_start(filter_ctx);
+
+  caml_release_runtime_system();
+  int err = av_buffersrc_add_frame_flags(filter_ctx, frame, flags);
+  caml_acquire_runtime_system();
+
+  profile_end(filter_ctx, err >= 0, start);
+
+  if (err < 0)
+    ocaml_avutil_raise_error(err);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avfilter_push_frames(value _config, value _filter,
+                                          value _check_format, value _transfer,
+                                          value _frames) {
+  CAMLparam5(_config, _filter, _check_format, _transfer, _frames);
+  AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  int flags = push_flags(_check_format, _transfer);
+  int i, err = 0, len = Wosize_val(_frames);
+  int64_t start;
+  AVFrame **frames;
+
+  if (!len)
+    CAMLreturn(Val_unit);
+
+  // Checked before anything is pushed.
+  for (i = 0; i < len; i++)
+    check_push(filter_ctx, Frame_val(Field(_frames, i)));
+
+  // Frame blocks may move once the runtime is released: collect the
+  // AVFrame pointers first.
+  frames = av_malloc_array(len, sizeof(AVFrame *));
+  if (!frames)
+    caml_raise_out_of_memory();
+
+  for (i = 0; i < len; i++)
+    frames[i] = Frame_val(Field(_frames, i));
+
+  start = profile_start(filter_ctx);
+
+  caml_release_runtime_system();
+  for (i = 0; i < len && err >= 0; i++)
+    err = av_buffersrc_add_frame_flags(filter_ctx, frames[i], flags);
+  caml_acquire_runtime_system();
+
+  profile_end(filter_ctx, err < 0 ? i - 1 : i, start);
+
+  av_free(frames);
+
   if (err < 0)
     ocaml_avutil_raise_error(err);
 
@@ -535,17 +849,34 @@ CAMLprim value ocaml_avfilter_write_frame(value _config, value _filter,
 CAMLprim value ocaml_avfilter_write_eof_frame(value _config, value _filter) {
   CAMLparam2(_config, _filter);
   AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  int64_t start = profile_start(filter_ctx);
 
   caml_release_runtime_system();
   int err = av_buffersrc_write_frame(filter_ctx, NULL);
   caml_acquire_runtime_system();
 
+  profile_end(filter_ctx, 0, start);
+
   if (err < 0)
     ocaml_avutil_raise_error(err);
 
   CAMLreturn(Val_unit);
 }
 
+/* Pulls the next frame of a sink into [frame], which must be clean. */
+static int get_frame(AVFilterContext *filter_ctx, AVFrame *frame) {
+  int64_t start = profile_start(filter_ctx);
+  int err;
+
+  caml_release_runtime_system();
+  err = av_buffersink_get_frame(filter_ctx, frame);
+  caml_acquire_runtime_system();
+
+  profile_end(filter_ctx, err >= 0, start);
+
+  return err;
+}
+
 CAMLprim value ocaml_avfilter_get_frame(value _config, value _filter) {
   CAMLparam2(_config, _filter);
   CAMLlocal1(frame_value);
@@ -557,9 +888,7 @@ CAMLprim value ocaml_avfilter_get_frame(value _config, value _filter) {
     caml_raise_out_of_memory();
   }
 
-  caml_release_runtime_system();
-  int err = av_buffersink_get_frame(filter_ctx, frame);
-  caml_acquire_runtime_system();
+  int err = get_frame(filter_ctx, frame);
 
   if (err < 0) {
     av_frame_free(&frame);
@@ -571,6 +900,434 @@ CAMLprim value ocaml_avfilter_get_frame(value _config, value _filter) {
   CAMLreturn(frame_value);
 }
 
+#define Is_status(err) ((err) == AVERROR(EAGAIN) || (err) == AVERROR_EOF)
+#define Val_status(err) ((err) == AVERROR_EOF ? PVV_Eof : PVV_Eagain)
+
+/* Frames passed as [into] are pulled into directly: their buffers are
+   released first, back to their pools if they come from one, and the
+   AVFrame itself is reused. */
+CAMLprim value ocaml_avfilter_pull_frame(value _config, value _filter,
+                                         value _into) {
+  CAMLparam3(_config, _filter, _into);
+  CAMLlocal2(frame_value, ret);
+  AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  AVFrame *frame;
+  int err;
+
+  if (_into != Val_none) {
+    frame_value = Some_val(_into);
+    frame = Frame_val(frame_value);
+    av_frame_unref(frame);
+  } else if (!(frame = av_frame_alloc()))
+    caml_raise_out_of_memory();
+
+  err = get_frame(filter_ctx, frame);
+
+  if (err < 0) {
+    if (_into == Val_none)
+      av_frame_free(&frame);
+    if (!Is_status(err))
+      ocaml_avutil_raise_error(err);
+    CAMLreturn(Val_status(err));
+  }
+
+  if (_into == Val_none)
+    value_of_frame(&frame_value, frame);
+
+  ret = caml_alloc_tuple(2);
+  Store_field(ret, 0, PVV_Frame);
+  Store_field(ret, 1, frame_value);
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avfilter_drain_frames(value _config, value _filter,
+                                           value _into) {
+  CAMLparam3(_config, _filter, _into);
+  CAMLlocal3(frames, frame_value, ret);
+  AVFilterContext *filter_ctx = AvFilterContext_val(_filter);
+  int i, j, err, len = 0, nb_into = Wosize_val(_into);
+  AVFrame *frame = NULL;
+
+  // A frame given twice would lose the first result pulled into it.
+  for (i = 1; i < nb_into; i++)
+    for (j = 0; j < i; j++)
+      if (Frame_val(Field(_into, i)) == Frame_val(Field(_into, j)))
+        ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  frames = caml_alloc_tuple(8);
+  for (i = 0; i < 8; i++)
+    Store_field(frames, i, Val_unit);
+
+  for (;;) {
+    if (len < nb_into) {
+      frame_value = Field(_into, len);
+      av_frame_unref(Frame_val(frame_value));
+      err = get_frame(filter_ctx, Frame_val(frame_value));
+      if (err < 0)
+        break;
+    } else {
+      if (!(frame = av_frame_alloc()))
+        caml_raise_out_of_memory();
+
+      err = get_frame(filter_ctx, frame);
+      if (err < 0)
+        break;
+
+      value_of_frame(&frame_value, frame);
+      frame = NULL;
+    }
+
+    if (len == (int)Wosize_val(frames)) {
+      ret = caml_alloc_tuple(2 * len);
+      for (i = 0; i < len; i++)
+        Store_field(ret, i, Field(frames, i));
+      for (; i < 2 * len; i++)
+        Store_field(ret, i, Val_unit);
+      frames = ret;
+    }
+
+    Store_field(frames, len++, frame_value);
+  }
+
+  av_frame_free(&frame);
+
+  if (!Is_status(err))
+    ocaml_avutil_raise_error(err);
+
+  frame_value = len ? caml_alloc_tuple(len) : Atom(0);
+  for (i = 0; i < len; i++)
+    Store_field(frame_value, i, Field(frames, i));
+
+  ret = caml_alloc_tuple(2);
+  Store_field(ret, 0, frame_value);
+  Store_field(ret, 1, Val_status(err));
+
+  CAMLreturn(ret);
+}
+
+/***** Broadcast *****/
+
+/* One sink feeding several consumers. Each consumer has a ring of frame
+   references, filled by [pump] and emptied by [take], possibly from other
+   threads: everything below [sink] is guarded by [mutex]. */
+
+enum { DROP_OLDEST, DROP_NEWEST, BLOCK };
+
+typedef struct {
+  AVFrame **frames;
+  int head;
+  int len;
+  int64_t dropped;
+  int active;
+} consumer_t;
+
+typedef struct {
+  AVFilterContext *sink;
+  pthread_mutex_t mutex;
+  pthread_cond_t space;
+  int capacity;
+  int policy;
+  int eof;
+  int nb_consumers;
+  consumer_t *consumers;
+} broadcast_t;
+
+#define Broadcast_val(v) (*(broadcast_t **)Data_custom_val(v))
+
+static void clear_consumer(consumer_t *consumer, int capacity) {
+  for (; consumer->len > 0; consumer->len--) {
+    av_frame_free(&consumer->frames[consumer->head]);
+    consumer->head = (consumer->head + 1) % capacity;
+  }
+}
+
+static void finalize_broadcast(value v) {
+  broadcast_t *broadcast = Broadcast_val(v);
+  int i;
+
+  for (i = 0; i < broadcast->nb_consumers; i++) {
+    clear_consumer(&broadcast->consumers[i], broadcast->capacity);
+    av_free(broadcast->consumers[i].frames);
+  }
+
+  av_free(broadcast->consumers);
+  pthread_cond_destroy(&broadcast->space);
+  pthread_mutex_destroy(&broadcast->mutex);
+  av_free(broadcast);
+}
+
+static struct custom_operations broadcast_ops = {
+    "ocaml_avfilter_broadcast", finalize_broadcast,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+CAMLprim value ocaml_avfilter_broadcast_create(value _filter, value _capacity,
+                                               value _policy) {
+  CAMLparam3(_filter, _capacity, _policy);
+  CAMLlocal1(ret);
+  broadcast_t *broadcast;
+
+  if (Int_val(_capacity) < 1)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  broadcast = av_mallocz(sizeof(broadcast_t));
+  if (!broadcast)
+    caml_raise_out_of_memory();
+
+  broadcast->sink = AvFilterContext_val(_filter);
+  broadcast->capacity = Int_val(_capacity);
+  broadcast->policy = Int_val(_policy);
+  pthread_mutex_init(&broadcast->mutex, NULL);
+  pthread_cond_init(&broadcast->space, NULL);
+
+  ret = caml_alloc_custom(&broadcast_ops, sizeof(broadcast_t *), 0, 1);
+  Broadcast_val(ret) = broadcast;
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avfilter_broadcast_subscribe(value _broadcast) {
+  CAMLparam1(_broadcast);
+  broadcast_t *broadcast = Broadcast_val(_broadcast);
+  consumer_t *consumers;
+  AVFrame **frames;
+  int n;
+
+  frames = av_malloc_array(broadcast->capacity, sizeof(AVFrame *));
+  if (!frames)
+    caml_raise_out_of_memory();
+
+  pthread_mutex_lock(&broadcast->mutex);
+  n = broadcast->nb_consumers;
+  consumers = av_realloc_array(broadcast->consumers, n + 1, sizeof(consumer_t));
+  if (consumers) {
+    consumers[n] = (consumer_t){frames, 0, 0, 0, 1};
+    broadcast->consumers = consumers;
+    broadcast->nb_consumers++;
+  }
+  pthread_mutex_unlock(&broadcast->mutex);
+
+  if (!consumers) {
+    av_free(frames);
+    caml_raise_out_of_memory();
+  }
+
+  CAMLreturn(Val_int(n));
+}
+
+CAMLprim value ocaml_avfilter_broadcast_unsubscribe(value _broadcast,
+                                                   value _consumer) {
+  CAMLparam2(_broadcast, _consumer);
+  broadcast_t *broadcast = Broadcast_val(_broadcast);
+  consumer_t *consumer;
+
+  pthread_mutex_lock(&broadcast->mutex);
+  consumer = &broadcast->consumers[Int_val(_consumer)];
+  clear_consumer(consumer, broadcast->capacity);
+  consumer->active = 0;
+  pthread_cond_broadcast(&broadcast->space);
+  pthread_mutex_unlock(&broadcast->mutex);
+
+  CAMLreturn(Val_unit);
+}
+
+/* Hands a reference to [frame] to every active consumer. Called with the
+   runtime released, as it may wait for room under the [BLOCK] policy. */
+static int dispatch(broadcast_t *broadcast, AVFrame *frame) {
+  consumer_t *consumer;
+  AVFrame *ref;
+  int i, err = 0;
+
+  pthread_mutex_lock(&broadcast->mutex);
+
+  for (i = 0; i < broadcast->nb_consumers && err >= 0; i++) {
+    consumer = &broadcast->consumers[i];
+
+    if (consumer->active && consumer->len == broadcast->capacity) {
+      switch (broadcast->policy) {
+      case DROP_OLDEST:
+        av_frame_free(&consumer->frames[consumer->head]);
+        consumer->head = (consumer->head + 1) % broadcast->capacity;
+        consumer->len--;
+        consumer->dropped++;
+        break;
+      case DROP_NEWEST:
+        consumer->dropped++;
+        continue;
+      default:
+        // Waiting lets [subscribe] move the consumers.
+        do {
+          pthread_cond_wait(&broadcast->space, &broadcast->mutex);
+          consumer = &broadcast->consumers[i];
+        } while (consumer->active && consumer->len == broadcast->capacity);
+      }
+    }
+
+    if (!consumer->active)
+      continue;
+
+    if (!(ref = av_frame_clone(frame))) {
+      err = AVERROR(ENOMEM);
+      break;
+    }
+
+    consumer->frames[(consumer->head + consumer->len) % broadcast->capacity] =
+        ref;
+    consumer->len++;
+  }
+
+  pthread_mutex_unlock(&broadcast->mutex);
+
+  return err;
+}
+
+CAMLprim value ocaml_avfilter_broadcast_pump(value _config, value _broadcast) {
+  CAMLparam2(_config, _broadcast);
+  broadcast_t *broadcast = Broadcast_val(_broadcast);
+  AVFrame *frame = av_frame_alloc();
+  int err;
+
+  if (!frame)
+    caml_raise_out_of_memory();
+
+  while ((err = get_frame(broadcast->sink, frame)) >= 0) {
+    caml_release_runtime_system();
+    err = dispatch(broadcast, frame);
+    caml_acquire_runtime_system();
+
+    av_frame_unref(frame);
+
+    if (err < 0)
+      break;
+  }
+
+  av_frame_free(&frame);
+
+  if (err == AVERROR_EOF) {
+    pthread_mutex_lock(&broadcast->mutex);
+    broadcast->eof = 1;
+    pthread_mutex_unlock(&broadcast->mutex);
+  }
+
+  if (!Is_status(err))
+    ocaml_avutil_raise_error(err);
+
+  CAMLreturn(Val_status(err));
+}
+
+CAMLprim value ocaml_avfilter_broadcast_take(value _broadcast,
+                                            value _consumer) {
+  CAMLparam2(_broadcast, _consumer);
+  CAMLlocal2(frame_value, ret);
+  broadcast_t *broadcast = Broadcast_val(_broadcast);
+  consumer_t *consumer;
+  AVFrame *frame = NULL;
+  int eof;
+
+  pthread_mutex_lock(&broadcast->mutex);
+  consumer = &broadcast->consumers[Int_val(_consumer)];
+  if (consumer->len > 0) {
+    frame = consumer->frames[consumer->head];
+    consumer->head = (consumer->head + 1) % broadcast->capacity;
+    consumer->len--;
+    pthread_cond_broadcast(&broadcast->space);
+  }
+  eof = broadcast->eof;
+  pthread_mutex_unlock(&broadcast->mutex);
+
+  if (!frame)
+    CAMLreturn(eof ? PVV_Eof : PVV_Eagain);
+
+  value_of_frame(&frame_value, frame);
+
+  ret = caml_alloc_tuple(2);
+  Store_field(ret, 0, PVV_Frame);
+  Store_field(ret, 1, frame_value);
+
+  CAMLreturn(ret);
+}
+
+/* (queued frames, dropped frames) */
+CAMLprim value ocaml_avfilter_broadcast_stats(value _broadcast,
+                                             value _consumer) {
+  CAMLparam2(_broadcast, _consumer);
+  CAMLlocal1(ret);
+  broadcast_t *broadcast = Broadcast_val(_broadcast);
+  consumer_t *consumer;
+  int64_t len, dropped;
+
+  pthread_mutex_lock(&broadcast->mutex);
+  consumer = &broadcast->consumers[Int_val(_consumer)];
+  len = consumer->len;
+  dropped = consumer->dropped;
+  pthread_mutex_unlock(&broadcast->mutex);
+
+  ret = caml_alloc_tuple(2);
+  Store_field(ret, 0, Val_int(len));
+  Store_field(ret, 1, Val_int(dropped));
+
+  CAMLreturn(ret);
+}
+
+static int is_buffersrc(AVFilterContext *filter_ctx) {
+  return !strcmp(filter_ctx->filter->name, "buffer") ||
+         !strcmp(filter_ctx->filter->name, "abuffer");
+}
+
+static int is_buffersink(AVFilterContext *filter_ctx) {
+  return !strcmp(filter_ctx->filter->name, "buffersink") ||
+         !strcmp(filter_ctx->filter->name, "abuffersink");
+}
+
+CAMLprim value ocaml_avfilter_profile(value _config) {
+  CAMLparam1(_config);
+  CAMLlocal3(ret, tmp, entry_value);
+  AVFilterGraph *graph = Filter_graph_val(_config);
+  profile_t *profile = graph->opaque;
+  profile_entry_t *entry;
+  AVFilterContext *filter_ctx;
+  unsigned int i, len = 0;
+  int j;
+
+  for (i = 0; i < graph->nb_filters; i++)
+    if (is_buffersrc(graph->filters[i]) || is_buffersink(graph->filters[i]))
+      len++;
+
+  ret = caml_alloc_tuple(len);
+  len = 0;
+
+  for (i = 0; i < graph->nb_filters; i++) {
+    filter_ctx = graph->filters[i];
+    if (!is_buffersrc(filter_ctx) && !is_buffersink(filter_ctx))
+      continue;
+
+    entry = NULL;
+    for (j = 0; profile && j < profile->len; j++)
+      if (profile->entries[j].filter == filter_ctx)
+        entry = &profile->entries[j];
+
+    entry_value = caml_alloc_tuple(6);
+    tmp = caml_copy_string(filter_ctx->name ? filter_ctx->name : "");
+    Store_field(entry_value, 0, tmp);
+    tmp = caml_copy_string(filter_ctx->filter->name);
+    Store_field(entry_value, 1, tmp);
+    Store_field(entry_value, 2, Val_bool(is_buffersrc(filter_ctx)));
+    Store_field(entry_value, 3, Val_int(entry ? entry->frames : 0));
+    tmp = caml_copy_double(entry ? entry->time / 1e6 : 0.);
+    Store_field(entry_value, 4, tmp);
+    Store_field(entry_value, 5,
+                Val_int(is_buffersrc(filter_ctx)
+                            ? av_buffersrc_get_nb_failed_requests(filter_ctx)
+                            : 0));
+
+    Store_field(ret, len++, entry_value);
+  }
+
+  CAMLreturn(ret);
+}
+
 CAMLprim value ocaml_avfilter_int_of_flag(value _flag) {
   CAMLparam1(_flag);
 
@@ -73,6 +73,18 @@ module Frame = struct
     = "ocaml_avutil_frame_best_effort_timestamp"
 
   external copy : 'a t -> 'b t -> unit = "ocaml_avutil_frame_copy"
+
+  external fingerprint : [< audio | video ] t -> Int64.t
+    = "ocaml_avutil_frame_fingerprint"
+
+  external perceptual_hash : [< audio | video ] t -> Int64.t
+    = "ocaml_avutil_frame_perceptual_hash"
+
+  let hash_distance a b =
+    let rec count n x =
+      if x = 0L then n else count (n + 1) (Int64.logand x (Int64.pred x))
+    in
+    count 0 (Int64.logxor a b)
 end
 
 type 'media frame = 'media Frame.t
@@ -157,14 +169,47 @@ module Log = struct
 
   let set_level level = set_level (int_of_level level)
 
+  let level_of_int = function
+    | l when l < 0 -> `Quiet
+    | l when l < 8 -> `Panic
+    | l when l < 16 -> `Fatal
+    | l when l < 24 -> `Error
+    | l when l < 32 -> `Warning
+    | l when l < 40 -> `Info
+    | l when l < 48 -> `Verbose
+    | l when l < 56 -> `Debug
+    | _ -> `Trace
+
+  type entry = {
+    level : level;
+    class_name : string;
+    context : nativeint;
+    message : string;
+  }
+
+  type stats = { dropped : int; rate_limited : int }
+
   external setup_log_callback : unit -> unit = "ocaml_avutil_setup_log_callback"
   external wait_for_logs : unit -> unit = "ocaml_ffmpeg_wait_for_logs"
   external signal_logs : unit -> unit = "ocaml_ffmpeg_signal_logs"
 
-  external get_pending_logs : unit -> string list
+  external get_pending_logs : unit -> (int * string * nativeint * string) array
     = "ocaml_ffmpeg_get_pending_logs"
 
+  let get_pending_logs () =
+    Array.map
+      (fun (level, class_name, context, message) ->
+        { level = level_of_int level; class_name; context; message })
+      (get_pending_logs ())
+
   external clear_callback : unit -> unit = "ocaml_avutil_clear_log_callback"
+  external set_capacity : int -> unit = "ocaml_avutil_set_log_capacity"
+  external set_rate_limit : int -> unit = "ocaml_avutil_set_log_rate_limit"
+  external stats : unit -> int * int = "ocaml_avutil_log_stats"
+
+  let stats () =
+    let dropped, rate_limited = stats () in
+    { dropped; rate_limited }
 
   let[@inline never] mutexify m f x =
     Mutex.lock m;
@@ -187,7 +232,8 @@ module Log = struct
       let should_stop =
         mutexify log_m
           (fun () ->
-            List.iter (Atomic.get log_thread_processor) (get_pending_logs ());
+            let entries = get_pending_logs () in
+            if entries <> [||] then (Atomic.get log_thread_processor) entries;
             if !log_thread_should_stop then (
               clear_callback ();
               log_thread := false;
@@ -201,7 +247,9 @@ module Log = struct
     in
     fn
 
-  let set_callback fn =
+  let set_capacity = mutexify log_m set_capacity
+
+  let set_bulk_callback fn =
     Atomic.set log_thread_processor fn;
     mutexify log_m
       (fun () ->
@@ -213,6 +261,9 @@ module Log = struct
           log_thread := true))
       ()
 
+  let set_callback fn =
+    set_bulk_callback (Array.iter (fun { message; _ } -> fn message))
+
   let clear_callback () =
     mutexify log_m
       (fun () ->
@@ -342,10 +393,27 @@ module Sample_format = struct
   external find_id : int -> t = "ocaml_avutil_find_sample_fmt_from_id"
 end
 
+module Frame_pool = struct
+  type t
+
+  external create : int -> t = "ocaml_avutil_frame_pool_create"
+
+  let create ?(max_shapes = 8) () = create max_shapes
+
+  external allocated : t -> int = "ocaml_avutil_frame_pool_allocated"
+end
+
 module Audio = struct
   external create_frame :
-    Sample_format.t -> Channel_layout.t -> int -> int -> audio frame
-    = "ocaml_avutil_audio_create_frame"
+    Frame_pool.t option ->
+    Sample_format.t ->
+    Channel_layout.t ->
+    int ->
+    int ->
+    audio frame = "ocaml_avutil_audio_create_frame"
+
+  let create_frame ?pool sample_format channel_layout sample_rate samples =
+    create_frame pool sample_format channel_layout sample_rate samples
 
   external frame_get_sample_format : audio frame -> Sample_format.t
     = "ocaml_avutil_audio_frame_get_sample_format"
@@ -365,20 +433,121 @@ module Audio = struct
   external frame_copy_samples :
     audio frame -> int -> audio frame -> int -> int -> unit
     = "ocaml_avutil_audio_frame_copy_samples"
+
+  external get_frame_planes :
+    audio frame ->
+    bool ->
+    ('a, 'b) Bigarray.kind ->
+    ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t array
+    = "ocaml_avutil_audio_get_frame_bigarray_planes"
+
+  let frame_planes ?(make_writable = false) kind frame =
+    get_frame_planes frame make_writable kind
+
+  external frame_of_bigarray :
+    Sample_format.t ->
+    Channel_layout.t ->
+    int ->
+    ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t array ->
+    audio frame = "ocaml_avutil_audio_frame_of_bigarray"
+
+  external mix :
+    Frame_pool.t option -> audio frame array -> float array -> audio frame
+    = "ocaml_avutil_audio_mix"
+
+  let mix ?pool ?gains frames =
+    let gains =
+      match gains with
+        | Some gains -> gains
+        | None -> Array.make (Array.length frames) 1.
+    in
+    mix pool frames gains
+
+  external ramp : audio frame -> float -> float -> unit
+    = "ocaml_avutil_audio_frame_ramp"
+
+  let gain frame gain = ramp frame gain gain
+
+  type level = { peak : float; rms : float }
+
+  external levels : audio frame -> level array
+    = "ocaml_avutil_audio_frame_levels"
+
+  module Loudness = struct
+    type t
+
+    external create : Channel_layout.t -> int -> t
+      = "ocaml_avutil_audio_loudness_create"
+
+    external process : t -> audio frame -> float
+      = "ocaml_avutil_audio_loudness_process"
+
+    external reset : t -> unit = "ocaml_avutil_audio_loudness_reset"
+  end
+
+  module Fifo = struct
+    type t
+
+    external create :
+      Sample_format.t -> Channel_layout.t -> int -> rational -> int -> t
+      = "ocaml_avutil_audio_fifo_create"
+
+    let create ?time_base ?(size = 1024) sample_format channel_layout
+        sample_rate =
+      let time_base =
+        match time_base with
+          | Some time_base -> time_base
+          | None -> { num = 1; den = sample_rate }
+      in
+      create sample_format channel_layout sample_rate time_base (max 1 size)
+
+    external size : t -> int = "ocaml_avutil_audio_fifo_size"
+    external reset : t -> unit = "ocaml_avutil_audio_fifo_reset"
+
+    external write_frame : t -> audio frame -> unit
+      = "ocaml_avutil_audio_fifo_write_frame"
+
+    external write : t -> Int64.t option -> int -> int -> data array -> unit
+      = "ocaml_avutil_audio_fifo_write"
+
+    let write ?pts ?(offset = 0) ?(length = -1) fifo planes =
+      write fifo pts offset length planes
+
+    external read : t -> bool -> int -> audio frame option
+      = "ocaml_avutil_audio_fifo_read"
+
+    let read ?(partial = false) fifo nb_samples = read fifo partial nb_samples
+  end
 end
 
 module Video = struct
   type planes = (data * int) array
 
-  external create_frame : int -> int -> Pixel_format.t -> video frame
+  external create_frame :
+    Frame_pool.t option -> int -> int -> Pixel_format.t -> video frame
     = "ocaml_avutil_video_create_frame"
 
+  let create_frame ?pool w h pixel_format = create_frame pool w h pixel_format
+
   external frame_get_linesize : video frame -> int -> int
     = "ocaml_avutil_video_frame_get_linesize"
 
   external get_frame_planes : video frame -> bool -> planes
     = "ocaml_avutil_video_get_frame_bigarray_planes"
 
+  let frame_planes ?(make_writable = false) frame =
+    get_frame_planes frame make_writable
+
+  external get_frame_palette : video frame -> bool -> data
+    = "ocaml_avutil_video_get_frame_bigarray_palette"
+
+  let frame_palette ?(make_writable = false) frame =
+    get_frame_palette frame make_writable
+
+  external frame_of_bigarrays :
+    int -> int -> Pixel_format.t -> planes -> video frame
+    = "ocaml_avutil_video_frame_of_bigarrays"
+
   let frame_visit ~make_writable visit frame =
     visit (get_frame_planes frame make_writable);
     frame
@@ -411,6 +580,32 @@ module Video = struct
     = "ocaml_avutil_video_frame_get_chroma_location"
 end
 
+module Shm_frame = struct
+  type descriptor = { fd : Unix.file_descr; layout : string }
+
+  external create_video : int -> int -> Pixel_format.t -> video frame
+    = "ocaml_avutil_shm_frame_create_video"
+
+  external create_audio :
+    Sample_format.t -> Channel_layout.t -> int -> int -> audio frame
+    = "ocaml_avutil_shm_frame_create_audio"
+
+  external descriptor : _ frame -> descriptor
+    = "ocaml_avutil_shm_frame_descriptor"
+
+  external video_frame : descriptor -> video frame
+    = "ocaml_avutil_shm_frame_map_video"
+
+  external audio_frame : descriptor -> audio frame
+    = "ocaml_avutil_shm_frame_map_audio"
+
+  external send : Unix.file_descr -> descriptor -> unit
+    = "ocaml_avutil_shm_frame_send"
+
+  external receive : Unix.file_descr -> descriptor
+    = "ocaml_avutil_shm_frame_receive"
+end
+
 module Subtitle = struct
   type frame
   type subtitle_type = Subtitle_type.t
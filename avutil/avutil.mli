@@ -67,6 +67,22 @@ module Frame : sig
 
   (** [Avutil.frame_copy src dst] copies data from [src] into [dst] *)
   val copy : 'a t -> 'b t -> unit
+
+  (** [Avutil.Frame.fingerprint frame] returns a hash of the format and
+      visible content of [frame], line padding excluded. Frames with the same
+      fingerprint can be assumed identical, e.g. for caching. Raises Error on
+      hardware frames. *)
+  val fingerprint : [< audio | video ] t -> Int64.t
+
+  (** [Avutil.Frame.perceptual_hash frame] returns a hash which changes
+      little when [frame] changes little: compare hashes with [hash_distance]
+      to detect frozen or duplicated frames. Video hashes follow luma on a
+      coarse grid, audio ones the energy over time. Raises Error on hardware
+      and floating point video frames. *)
+  val perceptual_hash : [< audio | video ] t -> Int64.t
+
+  (** Number of bits which differ between two hashes, from [0] to [64]. *)
+  val hash_distance : Int64.t -> Int64.t -> int
 end
 
 type 'media frame = 'media Frame.t
@@ -140,7 +156,41 @@ module Log : sig
     | `Trace ]
 
   val set_level : level -> unit
+
+  (** A log line. [class_name] is the name of the [AVClass] of the object it
+      was logged from, empty if none, and [context] the address of that
+      object. [message] is formatted as ffmpeg would print it. *)
+  type entry = {
+    level : level;
+    class_name : string;
+    context : nativeint;
+    message : string;
+  }
+
+  (** Lines lost since startup: [dropped] because the buffer was full,
+      [rate_limited] because their class exceeded its rate. *)
+  type stats = { dropped : int; rate_limited : int }
+
+  (** Lines are buffered in a fixed size ring, preallocated when a callback is
+      first set, and handed over to the callback from a dedicated thread.
+      [Avutil.Log.set_capacity n] sets the number of lines it holds, rounded
+      up to a power of two, [256] by default. Raises [Error (`Failure _)] once
+      a callback has been set, and [Error (`Other _)] (EINVAL) if [n] is not
+      between [1] and [2{^20}]. *)
+  val set_capacity : int -> unit
+
+  (** [Avutil.Log.set_rate_limit n] keeps at most [n] lines per second from
+      each [AVClass], e.g. to mute a decoder spamming about a broken stream.
+      [0], the default, disables rate limiting. *)
+  val set_rate_limit : int -> unit
+
+  val stats : unit -> stats
   val set_callback : (string -> unit) -> unit
+
+  (** Same as [set_callback], with the lines pending at each wake-up at
+      once. *)
+  val set_bulk_callback : (entry array -> unit) -> unit
+
   val clear_callback : unit -> unit
 end
 
@@ -305,11 +355,38 @@ module Pixel_format : sig
   val find_id : int -> t
 end
 
+(** {5 Frame pools} *)
+
+(** Recycled frame buffers. Frames created from a pool take their buffers
+    from it and give them back when released, so that producing frames of
+    the same shape over and over allocates no new buffers. A pool keeps
+    buffers for its [max_shapes] most recently used shapes: pixel format and
+    dimensions for video, sample format, channels and number of samples for
+    audio. *)
+module Frame_pool : sig
+  type t
+
+  (** [Avutil.Frame_pool.create ?max_shapes ()] creates an empty pool.
+      [max_shapes] defaults to [8]. *)
+  val create : ?max_shapes:int -> unit -> t
+
+  (** Number of buffers the pool had to allocate because none was free. A
+      buffer goes back to the pool when the last frame using it is released.
+      Audio frames take one buffer per plane, video frames a single one. *)
+  val allocated : t -> int
+end
+
 module Audio : sig
-  (** [Avutil.Audio.create_frame sample_format channel_layout sample_rate
-       samples] allocates a new audio frame. *)
+  (** [Avutil.Audio.create_frame ?pool sample_format channel_layout sample_rate
+       samples] allocates a new audio frame, with buffers from [pool] if
+      given. *)
   val create_frame :
-    Sample_format.t -> Channel_layout.t -> int -> int -> audio frame
+    ?pool:Frame_pool.t ->
+    Sample_format.t ->
+    Channel_layout.t ->
+    int ->
+    int ->
+    audio frame
 
   (** [Avutil.Audio.frame_get_sample_format frame] returns the sample format of
       the current frame. *)
@@ -336,28 +413,175 @@ module Audio : sig
       starting at position [dst_offset]. *)
   val frame_copy_samples :
     audio frame -> int -> audio frame -> int -> int -> unit
+
+  (** [Avutil.Audio.frame_planes ?make_writable kind frame] returns views of
+      the samples of [frame], without copy: one per channel for planar
+      formats, a single interleaved one otherwise. [kind] must match the
+      sample format, e.g. [Bigarray.float32] for [`Flt] and [`Fltp]. The views
+      keep the data alive on their own and cannot be compared as a whole or
+      marshalled. [make_writable] must be set if the views are written to.
+      The views hold references to the data: while earlier ones are alive,
+      [make_writable] copies the frame and they stop seeing its data, except
+      on shared memory frames. Take the views to write to first. Raises
+      Error if [kind] does not match. *)
+  val frame_planes :
+    ?make_writable:bool ->
+    ('a, 'b) Bigarray.kind ->
+    audio frame ->
+    ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t array
+
+  (** [Avutil.Audio.frame_of_bigarray sample_format channel_layout sample_rate
+       planes] returns a frame on the samples of [planes], without copy: one
+      plane per channel for planar formats, a single interleaved one
+      otherwise, all of the same length, and of the kind matching
+      [sample_format]. The frame and its references keep [planes] alive and
+      write to them once made writable, unless another reference, e.g. a
+      view from [frame_planes], is alive then: the frame is copied away from
+      [planes]. Raises Error if [planes] do not match the format. *)
+  val frame_of_bigarray :
+    Sample_format.t ->
+    Channel_layout.t ->
+    int ->
+    ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t array ->
+    audio frame
+
+  (** {5 Processing}
+
+      The functions below handle every sample format, compute in single
+      precision and saturate integer formats. *)
+
+  (** [Avutil.Audio.mix ?pool ?gains frames] returns the sum of [frames], each
+      scaled by its gain, [1.] by default. [frames] must not be empty and must
+      share their sample format, channel layout and number of samples. The
+      result takes the pts of the first frame. Raises Error otherwise. *)
+  val mix :
+    ?pool:Frame_pool.t -> ?gains:float array -> audio frame array -> audio frame
+
+  (** [Avutil.Audio.gain frame g] scales the samples of [frame] by [g], in
+      place. *)
+  val gain : audio frame -> float -> unit
+
+  (** [Avutil.Audio.ramp frame g0 g1] scales the samples of [frame], in place,
+      by a gain going linearly from [g0] on the first sample to [g1] one
+      sample past the last one, so that ramps on consecutive frames chain up,
+      e.g. for fades. *)
+  val ramp : audio frame -> float -> float -> unit
+
+  (** Absolute peak and RMS value of a channel, [1.] being full scale. *)
+  type level = { peak : float; rms : float }
+
+  (** [Avutil.Audio.levels frame] returns the levels of each channel of
+      [frame]. *)
+  val levels : audio frame -> level array
+
+  (** Loudness after ITU-R BS.1770. *)
+  module Loudness : sig
+    type t
+
+    (** [Avutil.Audio.Loudness.create channel_layout sample_rate] creates a
+        meter for frames of the given layout and rate. *)
+    val create : Channel_layout.t -> int -> t
+
+    (** [Avutil.Audio.Loudness.process meter frame] returns the loudness of
+        [frame], in LUFS, with the K-weighting filters carried over from the
+        previous frames. Feed 400ms frames for momentary loudness, 3s ones for
+        short-term loudness. *)
+    val process : t -> audio frame -> float
+
+    (** Clear the filters, e.g. after a seek. *)
+    val reset : t -> unit
+  end
+
+  (** Queue of audio samples, e.g. to cut decoded audio into the [frame_size]
+      an encoder expects. Not thread-safe. *)
+  module Fifo : sig
+    type t
+
+    (** [Avutil.Audio.Fifo.create ?time_base ?size sample_format channel_layout
+         sample_rate] creates an empty fifo with room for [size] samples before
+        it grows. Timestamps are in [time_base], [1/sample_rate] by default. *)
+    val create :
+      ?time_base:rational ->
+      ?size:int ->
+      Sample_format.t ->
+      Channel_layout.t ->
+      int ->
+      t
+
+    (** Number of samples in the fifo. *)
+    val size : t -> int
+
+    (** Drop all samples and the timestamp. *)
+    val reset : t -> unit
+
+    (** [Avutil.Audio.Fifo.write_frame fifo frame] appends the samples of
+        [frame], which must have the fifo's sample format and channel layout.
+        When [frame] has a pts, it becomes the pts of its first sample. *)
+    val write_frame : t -> audio frame -> unit
+
+    (** [Avutil.Audio.Fifo.write ?pts ?offset ?length fifo planes] appends
+        [length] samples from [planes], starting at sample [offset]: one plane
+        per channel for planar formats, one interleaved plane otherwise.
+        [length] defaults to the rest of the planes. Raises Error if the
+        planes do not hold [length] samples past [offset]. *)
+    val write :
+      ?pts:Int64.t -> ?offset:int -> ?length:int -> t -> data array -> unit
+
+    (** [Avutil.Audio.Fifo.read ?partial fifo n] removes the next [n] samples
+        and returns them as a frame, timestamped from the written ones. Returns
+        [None] when fewer than [n] samples are available, unless [partial] is
+        [true], in which case the remaining samples are returned if any. *)
+    val read : ?partial:bool -> t -> int -> audio frame option
+  end
 end
 
 module Video : sig
   type planes = (data * int) array
 
-  (** [Avutil.Video.create_frame w h pf] create a video frame with [w] width,
-      [h] height and [pf] pixel format. Raises Error if the allocation failed.
-  *)
-  val create_frame : int -> int -> Pixel_format.t -> video frame
+  (** [Avutil.Video.create_frame ?pool w h pf] create a video frame with [w]
+      width, [h] height and [pf] pixel format, with buffers from [pool] if
+      given. Raises Error if the allocation failed. *)
+  val create_frame :
+    ?pool:Frame_pool.t -> int -> int -> Pixel_format.t -> video frame
 
   (** [Avutil.Video.frame_get_linesize vf n] return the line size of the [n]
       plane of the [vf] video frame. Raises Error if [n] is out of boundaries.
   *)
   val frame_get_linesize : video frame -> int -> int
 
+  (** [Avutil.Video.frame_planes ?make_writable vf] returns views of the planes
+      of [vf] with their line sizes, without copy. The views keep the data
+      alive on their own and cannot be compared as a whole or marshalled.
+      [make_writable] must be set if the views are written to. The views hold
+      references to the data: while earlier ones, palette included, are
+      alive, [make_writable] copies the frame and they stop seeing its data,
+      except on shared memory frames. Take the views to write to first.
+      Raises Error if the make frame writable operation failed. *)
+  val frame_planes : ?make_writable:bool -> video frame -> planes
+
+  (** [Avutil.Video.frame_palette ?make_writable vf] returns a view of the
+      palette of [vf], 256 native endian 32 bits ARGB entries, on the same
+      terms as [frame_planes]: with [make_writable], views of the planes
+      taken earlier no longer see the frame's data if it had to be copied.
+      Raises Error if [vf] has no palette. *)
+  val frame_palette : ?make_writable:bool -> video frame -> data
+
+  (** [Avutil.Video.frame_of_bigarrays w h pf planes] returns a frame on
+      [planes] with their line sizes, without copy. The frame and its
+      references keep [planes] alive and write to them once made writable,
+      unless another reference, e.g. a view from [frame_planes], is alive
+      then: the frame is copied away from [planes]. Encoders and filters
+      may read past the end of lines and planes: line sizes should be
+      multiples of 64 and planes padded accordingly. Raises Error if [planes]
+      are too small for the format, and on palette and hardware formats. *)
+  val frame_of_bigarrays : int -> int -> Pixel_format.t -> planes -> video frame
+
   (** [Avutil.Video.frame_visit ~make_writable:wrt f vf] call the [f] function
       with planes wrapping the [vf] video frame data. The make_writable:[wrt]
       parameter must be set to true if the [f] function writes in the planes.
-      Access to the frame through the planes is safe as long as it occurs in the
-      [f] function and the frame is not sent to an encoder. The same frame is
-      returned for convenience. Raises Error if the make frame writable
-      operation failed. *)
+      Writes through the planes should happen before the frame is sent to an
+      encoder. The same frame is returned for convenience. Raises Error if the
+      make frame writable operation failed. *)
   val frame_visit :
     make_writable:bool -> (planes -> unit) -> video frame -> video frame
 
@@ -386,6 +610,55 @@ module Video : sig
   val frame_get_chroma_location : video frame -> Chroma_location.t
 end
 
+(** {5 Shared memory frames} *)
+
+(** Frames whose data lives in shared memory, to hand them over to another
+    process without copy. Linux only: raises Error elsewhere. *)
+module Shm_frame : sig
+  (** A shared frame as seen from another process: a file descriptor on its
+      data and a description of its layout. [layout] is an opaque string,
+      valid between processes of the same architecture. *)
+  type descriptor = { fd : Unix.file_descr; layout : string }
+
+  (** [Avutil.Shm_frame.create_video w h pf] allocates a video frame in
+      shared memory. *)
+  val create_video : int -> int -> Pixel_format.t -> video frame
+
+  (** [Avutil.Shm_frame.create_audio sample_format channel_layout sample_rate
+       samples] allocates an audio frame in shared memory. Planar formats are
+      limited to 8 channels. *)
+  val create_audio :
+    Sample_format.t -> Channel_layout.t -> int -> int -> audio frame
+
+  (** [Avutil.Shm_frame.descriptor frame] returns the descriptor of a frame
+      allocated by this module or mapped from a descriptor, with its current
+      pts and time base. The file descriptor is a new one, to be closed by the
+      caller once sent. Raises Error if [frame] is not in shared memory or its
+      planes have moved. *)
+  val descriptor : _ frame -> descriptor
+
+  (** [Avutil.Shm_frame.video_frame descriptor] maps the frame described by
+      [descriptor]. Its data is shared with the original one: writes on
+      either side are seen by the other. Making a shared frame writable,
+      e.g. with [frame_planes ~make_writable:true], never copies it, even
+      when other references to its data exist. [descriptor.fd] can be closed
+      afterwards. Frames allocated by this module have their size sealed.
+      Raises Error if [descriptor.fd] is too small or can still be shrunk. *)
+  val video_frame : descriptor -> video frame
+
+  (** Same as [video_frame], for audio frames. *)
+  val audio_frame : descriptor -> audio frame
+
+  (** [Avutil.Shm_frame.send socket descriptor] sends [descriptor] over a Unix
+      domain [socket], passing its file descriptor along. *)
+  val send : Unix.file_descr -> descriptor -> unit
+
+  (** [Avutil.Shm_frame.receive socket] receives a descriptor sent with
+      [send]. Its file descriptor is owned by the caller. Raises [End_of_file]
+      if the peer closed the connection. *)
+  val receive : Unix.file_descr -> descriptor
+end
+
 (** {5 Subtitle utilities} *)
 
 module Subtitle : sig
@@ -1,8 +1,26 @@
+#ifdef __linux__
+// For memfd_create.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define HAVE_SHM_FRAME
+#endif
+
 #include <assert.h>
+#include <math.h>
 #include <pthread.h>
 #include <stdatomic.h>
 #include <string.h>
 
+#ifdef HAVE_SHM_FRAME
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define CAML_NAME_SPACE 1
 
 #include <caml/alloc.h>
@@ -13,13 +31,18 @@
 #include <caml/memory.h>
 #include <caml/mlvalues.h>
 #include <caml/threads.h>
+#include <caml/version.h>
 
+#include <libavutil/audio_fifo.h>
 #include <libavutil/avassert.h>
 #include <libavutil/avstring.h>
 #include <libavutil/eval.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/pixfmt.h>
+#include <libavutil/time.h>
 
 #include "avutil_stubs.h"
 #include "channel_layout_stubs.h"
@@ -139,6 +162,138 @@ value ocaml_avutil_unused_options(AVDictionary **options) {
   CAMLreturn(unused);
 }
 
+/***** Generated enum tables *****/
+
+/* Entries are indices into the table. [sorted] holds all of them, stably
+   sorted by C value. [dense] covers the densest run of C values: slot
+   [c - c_min] holds the entry for C value [c], or -1. Lookups outside of
+   it, e.g. AV_CODEC_ID_NONE in the audio codec ids, bisect [sorted]. */
+struct ocaml_avutil_enum_index {
+  int64_t c_min;
+  uint64_t span;
+  int *dense;
+  int sorted[];
+};
+
+// Largest dense window for a table of [len] entries.
+#define ENUM_DENSE_SPAN(len) (4 * (uint64_t)(len) + 64)
+
+int ocaml_avutil_enum_find_ml(const ocaml_avutil_enum_t *e, value v) {
+  int lo = 0, hi = e->len - 1, mid;
+  int64_t key = (int64_t)v, cur;
+
+  while (lo <= hi) {
+    mid = lo + (hi - lo) / 2;
+    cur = e->tab[e->by_ml[mid]][0];
+    if (cur == key)
+      return e->by_ml[mid];
+    if (cur < key)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+
+  return -1;
+}
+
+static struct ocaml_avutil_enum_index *
+enum_build_c_index(const ocaml_avutil_enum_t *e) {
+  struct ocaml_avutil_enum_index *index;
+  int64_t c;
+  uint64_t max_span = ENUM_DENSE_SPAN(e->len), n;
+  int i, j, lo = 0, best_lo = 0, best_hi = -1;
+
+  index = av_malloc(sizeof(struct ocaml_avutil_enum_index) +
+                    (e->len + max_span) * sizeof(int));
+  if (!index)
+    return NULL;
+
+  // Tables are a few hundred entries at most and this runs once.
+  for (i = 0; i < e->len; i++) {
+    c = e->tab[i][1];
+    for (j = i; j > 0 && e->tab[index->sorted[j - 1]][1] > c; j--)
+      index->sorted[j] = index->sorted[j - 1];
+    index->sorted[j] = i;
+  }
+
+#define Sorted_c(n) ((uint64_t)e->tab[index->sorted[n]][1])
+
+  /* Two pointers over the sorted values for the window holding the most
+     entries. Unsigned differences: flags tables hold bitmasks. */
+  for (i = 0; i < e->len; i++) {
+    while (Sorted_c(i) - Sorted_c(lo) >= max_span)
+      lo++;
+    if (i - lo > best_hi - best_lo) {
+      best_lo = lo;
+      best_hi = i;
+    }
+  }
+
+  index->dense = index->sorted + e->len;
+  index->span = 0;
+  index->c_min = 0;
+
+  if (best_hi >= 0) {
+    index->c_min = (int64_t)Sorted_c(best_lo);
+    index->span = Sorted_c(best_hi) - Sorted_c(best_lo) + 1;
+
+    for (n = 0; n < index->span; n++)
+      index->dense[n] = -1;
+
+    // Backwards so that the first of several aliases wins.
+    for (i = best_hi; i >= best_lo; i--)
+      index->dense[Sorted_c(i) - (uint64_t)index->c_min] = index->sorted[i];
+  }
+
+#undef Sorted_c
+
+  return index;
+}
+int ocaml_avutil_enum_find_c(ocaml_avutil_enum_t *e, int64_t c) {
+  struct ocaml_avutil_enum_index *index, *expected = NULL;
+  uint64_t offset;
+  int lo, hi, mid, i;
+
+  index = atomic_load_explicit(&e->c_index, memory_order_acquire);
+
+  if (!index) {
+    index = enum_build_c_index(e);
+
+    if (!index) {
+      for (i = 0; i < e->len; i++)
+        if (e->tab[i][1] == c)
+          return i;
+      return -1;
+    }
+
+    // Another thread may have raced us here: keep whichever came first.
+    if (!atomic_compare_exchange_strong(&e->c_index, &expected, index)) {
+      av_free(index);
+      index = expected;
+    }
+  }
+
+  offset = (uint64_t)c - (uint64_t)index->c_min;
+  if (offset < index->span)
+    return index->dense[offset];
+
+  // Leftmost match, so that the first of several aliases wins.
+  lo = 0;
+  hi = e->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (e->tab[index->sorted[mid]][1] < c)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo < e->len && e->tab[index->sorted[lo]][1] == c)
+    return index->sorted[lo];
+
+  return -1;
+}
+
 CAMLprim value ocaml_avutil_qp2lambda(value unit) {
   (void)unit;
   CAMLparam0();
@@ -277,41 +432,160 @@ CAMLprim value ocaml_avutil_set_log_level(value level) {
 }
 
 #define LINE_SIZE 1024
-
-typedef struct log_msg_t {
+#define LOG_CLASS_SIZE 32
+#define LOG_DEFAULT_CAPACITY 256
+#define LOG_RATE_SLOTS 64
+
+/* Lines go through a bounded multi-producer ring, after Dmitry Vyukov's:
+   [seq] tells a slot's state, [pos] when free for writing at [pos],
+   [pos + 1] once filled. Producers claim a slot by moving [head], fill it
+   in place and publish it, so logging never allocates. Lines are dropped
+   when the ring is full. */
+typedef struct {
+  _Atomic size_t seq;
+  int level;
+  void *ctx;
+  char class_name[LOG_CLASS_SIZE];
   char msg[LINE_SIZE];
-  struct log_msg_t *next;
-} log_msg_t;
+} log_entry_t;
+
+typedef struct {
+  size_t mask;
+  _Atomic size_t head;
+  _Atomic size_t tail;
+  log_entry_t entries[];
+} log_ring_t;
+
+/* Per class rate limiting: at most [log_rate_limit] lines per class and
+   second. Classes get a slot on first use, by open addressing; lines of
+   classes that find no slot are not limited. */
+typedef struct {
+  _Atomic(const AVClass *) avc;
+  _Atomic int64_t second;
+  _Atomic int count;
+} log_rate_t;
+
+static _Atomic(log_ring_t *) log_ring = NULL;
+static _Atomic int log_capacity = LOG_DEFAULT_CAPACITY;
+static _Atomic int log_rate_limit = 0;
+static _Atomic intnat log_dropped = 0;
+static _Atomic intnat log_rate_limited = 0;
+static log_rate_t log_rates[LOG_RATE_SLOTS];
+// Stands for lines logged without context.
+static const AVClass log_no_class = {.class_name = ""};
 
-static _Atomic(log_msg_t *) log_head = NULL;
 static pthread_cond_t log_condition = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static int log_rate_exceeded(const AVClass *avc, int limit) {
+  const AVClass *expected;
+  int64_t second, current;
+  log_rate_t *rate;
+  size_t i, h = ((uintptr_t)avc >> 4) % LOG_RATE_SLOTS;
+
+  for (i = 0; i < LOG_RATE_SLOTS; i++) {
+    rate = &log_rates[(h + i) % LOG_RATE_SLOTS];
+    expected = atomic_load(&rate->avc);
+
+    if (expected == avc)
+      break;
+
+    if (!expected && (atomic_compare_exchange_strong(&rate->avc, &expected,
+                                                     avc) ||
+                      expected == avc))
+      break;
+  }
+
+  if (i == LOG_RATE_SLOTS)
+    return 0;
+
+  second = av_gettime_relative() / 1000000;
+  current = atomic_load(&rate->second);
+  if (current != second &&
+      atomic_compare_exchange_strong(&rate->second, &current, second))
+    atomic_store(&rate->count, 0);
+
+  return atomic_fetch_add(&rate->count, 1) >= limit;
+}
+
 static void av_log_ocaml_callback(void *ptr, int level, const char *fmt,
                                   va_list vl) {
   static _Atomic int print_prefix = 1;
-  log_msg_t *msg, *old_head;
-  int prefix;
+  log_ring_t *ring = atomic_load(&log_ring);
+  const AVClass *avc = ptr ? *(const AVClass **)ptr : NULL;
+  int prefix, limit;
+  log_entry_t *entry;
+  size_t pos, seq;
 
-  if (level > av_log_get_level())
+  if (level > av_log_get_level() || !ring)
     return;
 
-  msg = (log_msg_t *)av_malloc(sizeof(log_msg_t));
-  if (!msg)
+  limit = atomic_load(&log_rate_limit);
+  if (limit > 0 && log_rate_exceeded(avc ? avc : &log_no_class, limit)) {
+    atomic_fetch_add(&log_rate_limited, 1);
     return;
+  }
+
+  pos = atomic_load(&ring->head);
+  for (;;) {
+    entry = &ring->entries[pos & ring->mask];
+    seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+
+    if (seq == pos) {
+      if (atomic_compare_exchange_weak(&ring->head, &pos, pos + 1))
+        break;
+    } else if ((intptr_t)(seq - pos) < 0) {
+      atomic_fetch_add(&log_dropped, 1);
+      return;
+    } else
+      pos = atomic_load(&ring->head);
+  }
+
+  entry->level = level;
+  entry->ctx = ptr;
+  av_strlcpy(entry->class_name, avc ? avc->class_name : "", LOG_CLASS_SIZE);
 
   prefix = atomic_load(&print_prefix);
-  av_log_format_line2(ptr, level, fmt, vl, msg->msg, LINE_SIZE, &prefix);
+  av_log_format_line2(ptr, level, fmt, vl, entry->msg, LINE_SIZE, &prefix);
   atomic_store(&print_prefix, prefix);
 
-  do {
-    old_head = atomic_load(&log_head);
-    msg->next = old_head;
-  } while (!atomic_compare_exchange_weak(&log_head, &old_head, msg));
+  atomic_store_explicit(&entry->seq, pos + 1, memory_order_release);
 
   pthread_cond_signal(&log_condition);
 }
 
+CAMLprim value ocaml_avutil_set_log_capacity(value _capacity) {
+  CAMLparam1(_capacity);
+
+  if (Int_val(_capacity) < 1 || Int_val(_capacity) > (1 << 20))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  if (atomic_load(&log_ring))
+    Fail("Log capacity cannot be changed once logging has started");
+
+  atomic_store(&log_capacity, Int_val(_capacity));
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avutil_set_log_rate_limit(value _limit) {
+  CAMLparam1(_limit);
+  atomic_store(&log_rate_limit, FFMAX(Int_val(_limit), 0));
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avutil_log_stats(value unit) {
+  (void)unit;
+  CAMLparam0();
+  CAMLlocal1(ans);
+
+  ans = caml_alloc_tuple(2);
+  Store_field(ans, 0, Val_long(atomic_load(&log_dropped)));
+  Store_field(ans, 1, Val_long(atomic_load(&log_rate_limited)));
+
+  CAMLreturn(ans);
+}
+
 CAMLprim value ocaml_ffmpeg_wait_for_logs(value unit) {
   (void)unit;
   CAMLparam0();
@@ -332,43 +606,109 @@ CAMLprim value ocaml_ffmpeg_signal_logs(value unit) {
   CAMLreturn(Val_unit);
 }
 
+/* Takes the next filled entry, if any. The slot stays claimed until
+   [log_release]. */
+static log_entry_t *log_take(log_ring_t *ring, size_t *ppos) {
+  log_entry_t *entry;
+  size_t pos, seq;
+
+  pos = atomic_load(&ring->tail);
+  for (;;) {
+    entry = &ring->entries[pos & ring->mask];
+    seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+
+    if (seq == pos + 1) {
+      if (atomic_compare_exchange_weak(&ring->tail, &pos, pos + 1)) {
+        *ppos = pos;
+        return entry;
+      }
+    } else if ((intptr_t)(seq - (pos + 1)) < 0)
+      return NULL;
+    else
+      pos = atomic_load(&ring->tail);
+  }
+}
+
+static void log_release(log_ring_t *ring, log_entry_t *entry, size_t pos) {
+  atomic_store_explicit(&entry->seq, pos + ring->mask + 1,
+                        memory_order_release);
+}
+
 CAMLprim value ocaml_ffmpeg_get_pending_logs(value unit) {
   (void)unit;
   CAMLparam0();
-  CAMLlocal2(result, cons);
-  log_msg_t *msgs, *prev, *curr, *next;
-
-  msgs = atomic_exchange(&log_head, NULL);
-  if (msgs == NULL)
-    CAMLreturn(Val_emptylist);
-
-  prev = NULL;
-  curr = msgs;
-  while (curr) {
-    next = curr->next;
-    curr->next = prev;
-    prev = curr;
-    curr = next;
+  CAMLlocal3(ans, entry, tmp);
+  log_ring_t *ring = atomic_load(&log_ring);
+  log_entry_t *e;
+  size_t pos, len, i = 0, j;
+
+  if (!ring)
+    CAMLreturn(Atom(0));
+
+  // Lines logged meanwhile are left for the next call.
+  len = atomic_load(&ring->head) - atomic_load(&ring->tail);
+  len = FFMIN(len, ring->mask + 1);
+  if (len == 0)
+    CAMLreturn(Atom(0));
+
+  ans = caml_alloc_tuple(len);
+  for (j = 0; j < len; j++)
+    Store_field(ans, j, Val_unit);
+
+  while (i < len && (e = log_take(ring, &pos))) {
+    // (level, class_name, context, message)
+    entry = caml_alloc_tuple(4);
+    Store_field(entry, 0, Val_int(e->level));
+    tmp = caml_copy_string(e->class_name);
+    Store_field(entry, 1, tmp);
+    tmp = caml_copy_nativeint((intnat)e->ctx);
+    Store_field(entry, 2, tmp);
+    tmp = caml_copy_string(e->msg);
+    Store_field(entry, 3, tmp);
+    log_release(ring, e, pos);
+
+    Store_field(ans, i++, entry);
   }
 
-  result = Val_emptylist;
-  while (prev) {
-    cons = caml_alloc(2, 0);
-    Store_field(cons, 0, caml_copy_string(prev->msg));
-    Store_field(cons, 1, result);
-    result = cons;
+  // Slots still being written: return what is ready.
+  if (i < len) {
+    if (i == 0)
+      CAMLreturn(Atom(0));
 
-    curr = prev;
-    prev = prev->next;
-    av_free(curr);
+    tmp = caml_alloc_tuple(i);
+    for (j = 0; j < i; j++)
+      Store_field(tmp, j, Field(ans, j));
+    ans = tmp;
   }
 
-  CAMLreturn(result);
+  CAMLreturn(ans);
 }
 
 CAMLprim value ocaml_avutil_setup_log_callback(value unit) {
   (void)unit;
   CAMLparam0();
+  log_ring_t *ring;
+  size_t i, capacity = 1;
+
+  /* Rings are never freed: lines may still be on their way in from
+     other threads when the callback is cleared. */
+  if (!atomic_load(&log_ring)) {
+    while (capacity < (size_t)atomic_load(&log_capacity))
+      capacity <<= 1;
+
+    ring = av_malloc(sizeof(log_ring_t) + capacity * sizeof(log_entry_t));
+    if (!ring)
+      caml_raise_out_of_memory();
+
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    for (i = 0; i < capacity; i++)
+      atomic_init(&ring->entries[i].seq, i);
+
+    atomic_store(&log_ring, ring);
+  }
+
   av_log_set_callback(&av_log_ocaml_callback);
   CAMLreturn(Val_unit);
 }
@@ -844,6 +1184,64 @@ CAMLprim value ocaml_avutil_pixelformat_of_string(value name) {
 
 /***** AVFrame *****/
 
+/* Buffers wrapping OCaml bigarrays keep them alive through a global root.
+   FFmpeg may drop the last reference from any of its threads, and
+   finalizers may too, where roots cannot be removed. Released buffers are
+   queued here and their roots removed by the next collection, which every
+   new frame value runs, so at most the buffers released since the last
+   frame was made are held. */
+typedef struct bigarray_buffer_t {
+  value data;
+  struct bigarray_buffer_t *next;
+} bigarray_buffer_t;
+
+static _Atomic(bigarray_buffer_t *) released_bigarray_buffers = NULL;
+
+static void bigarray_buffer_free(void *opaque, uint8_t *data) {
+  bigarray_buffer_t *buffer = opaque;
+  bigarray_buffer_t *head = atomic_load(&released_bigarray_buffers);
+  (void)data;
+
+  do
+    buffer->next = head;
+  while (!atomic_compare_exchange_weak(&released_bigarray_buffers, &head,
+                                       buffer));
+}
+
+// Must be called with the runtime, outside of finalizers.
+static void collect_bigarray_buffers(void) {
+  bigarray_buffer_t *buffer, *next;
+
+  buffer = atomic_exchange(&released_bigarray_buffers, NULL);
+  for (; buffer; buffer = next) {
+    next = buffer->next;
+    caml_remove_generational_global_root(&buffer->data);
+    av_free(buffer);
+  }
+}
+
+static int bigarray_buffer(value _data, AVBufferRef **buf) {
+  bigarray_buffer_t *buffer = av_malloc(sizeof(bigarray_buffer_t));
+
+  if (!buffer)
+    return AVERROR(ENOMEM);
+
+  buffer->data = _data;
+  caml_register_generational_global_root(&buffer->data);
+
+  *buf = av_buffer_create(Caml_ba_data_val(_data),
+                          caml_ba_byte_size(Caml_ba_array_val(_data)),
+                          bigarray_buffer_free, buffer, 0);
+
+  if (!*buf) {
+    caml_remove_generational_global_root(&buffer->data);
+    av_free(buffer);
+    return AVERROR(ENOMEM);
+  }
+
+  return 0;
+}
+
 static void finalize_frame(value v) {
   AVFrame *frame = Frame_val(v);
   av_frame_free(&frame);
@@ -862,6 +1260,8 @@ void value_of_frame(value *ret, AVFrame *frame) {
   if (!frame)
     Fail("Empty frame");
 
+  collect_bigarray_buffers();
+
   int size = 0;
   int n = 0;
   while (n < AV_NUM_DATA_POINTERS && frame->buf[n] != NULL) {
@@ -1030,19 +1430,258 @@ CAMLprim value ocaml_avutil_frame_copy(value _src, value _dst) {
   CAMLreturn(Val_unit);
 }
 
-CAMLprim value ocaml_avutil_video_create_frame(value _w, value _h,
+/***** Frame pools *****/
+
+// As av_frame_get_buffer, plus room for SIMD reads past the last line.
+#define FRAME_POOL_ALIGN 32
+#define FRAME_POOL_PADDING 64
+
+/* Buffers for one frame shape. Video frames take a single buffer, audio
+   frames one per plane. */
+typedef struct {
+  enum AVMediaType type;
+  int format;
+  int width;
+  int height;
+  int channels;
+  int nb_samples;
+  AVBufferPool *pool;
+} frame_pool_entry_t;
+
+// Entries are most recently used first.
+typedef struct {
+  int nb_entries;
+  int max_entries;
+  int64_t allocated;
+  frame_pool_entry_t entries[];
+} frame_pool_t;
+
+#define Frame_pool_val(v) (*(frame_pool_t **)Data_custom_val(v))
+
+static frame_pool_t *frame_pool_alloc(int max_entries) {
+  frame_pool_t *pool = av_mallocz(sizeof(frame_pool_t) +
+                                  max_entries * sizeof(frame_pool_entry_t));
+
+  if (pool)
+    pool->max_entries = max_entries;
+
+  return pool;
+}
+
+static void frame_pool_free(frame_pool_t *pool) {
+  int i;
+
+  if (!pool)
+    return;
+
+  // Frames still holding buffers keep their AVBufferPool alive.
+  for (i = 0; i < pool->nb_entries; i++)
+    av_buffer_pool_uninit(&pool->entries[i].pool);
+
+  av_free(pool);
+}
+
+// Counts the buffers that could not be reused.
+static AVBufferRef *frame_pool_alloc_buffer(void *opaque, size_t size) {
+  frame_pool_t *pool = opaque;
+
+  pool->allocated++;
+
+  return av_buffer_alloc(size);
+}
+
+static AVBufferPool *frame_pool_find(frame_pool_t *pool,
+                                     frame_pool_entry_t *key, size_t size) {
+  frame_pool_entry_t *entries = pool->entries;
+  int i;
+
+  for (i = 0; i < pool->nb_entries; i++)
+    if (entries[i].type == key->type && entries[i].format == key->format &&
+        entries[i].width == key->width && entries[i].height == key->height &&
+        entries[i].channels == key->channels &&
+        entries[i].nb_samples == key->nb_samples)
+      break;
+
+  if (i < pool->nb_entries)
+    key->pool = entries[i].pool;
+  else {
+    if (size > INT_MAX)
+      return NULL;
+
+    key->pool = av_buffer_pool_init2(size, pool, frame_pool_alloc_buffer, NULL);
+    if (!key->pool)
+      return NULL;
+
+    if (pool->nb_entries == pool->max_entries)
+      av_buffer_pool_uninit(&entries[--pool->nb_entries].pool);
+
+    i = pool->nb_entries++;
+  }
+
+  memmove(entries + 1, entries, i * sizeof(frame_pool_entry_t));
+  entries[0] = *key;
+
+  return key->pool;
+}
+
+/* [frame] has its format and dimensions set. Returns an AVERROR on failure,
+   after which the caller still owns and frees [frame]. */
+static int frame_pool_get_video_buffer(frame_pool_t *pool, AVFrame *frame) {
+  frame_pool_entry_t key = {0};
+  int padded_height = FFALIGN(frame->height, 32);
+  ptrdiff_t linesizes[4];
+  size_t sizes[4], size = FRAME_POOL_PADDING;
+  AVBufferPool *buffers;
+  int i, ret;
+
+  key.type = AVMEDIA_TYPE_VIDEO;
+  key.format = frame->format;
+  key.width = frame->width;
+  key.height = frame->height;
+
+  ret = av_image_fill_linesizes(frame->linesize, frame->format,
+                                FFALIGN(frame->width, FRAME_POOL_ALIGN));
+  if (ret < 0)
+    return ret;
+
+  for (i = 0; i < 4; i++) {
+    frame->linesize[i] = FFALIGN(frame->linesize[i], FRAME_POOL_ALIGN);
+    linesizes[i] = frame->linesize[i];
+  }
+
+  ret = av_image_fill_plane_sizes(sizes, frame->format, padded_height,
+                                  linesizes);
+  if (ret < 0)
+    return ret;
+
+  for (i = 0; i < 4; i++)
+    size += sizes[i];
+
+  buffers = frame_pool_find(pool, &key, size);
+  if (!buffers)
+    return AVERROR(ENOMEM);
+
+  frame->buf[0] = av_buffer_pool_get(buffers);
+  if (!frame->buf[0])
+    return AVERROR(ENOMEM);
+
+  ret = av_image_fill_pointers(frame->data, frame->format, padded_height,
+                               frame->buf[0]->data, frame->linesize);
+  if (ret < 0)
+    return ret;
+
+  frame->extended_data = frame->data;
+
+  return 0;
+}
+
+/* [frame] has its format, channel layout and number of samples set. Same
+   contract as above. */
+static int frame_pool_get_audio_buffer(frame_pool_t *pool, AVFrame *frame) {
+  frame_pool_entry_t key = {0};
+  int channels = frame->ch_layout.nb_channels;
+  int planes = av_sample_fmt_is_planar(frame->format) ? channels : 1;
+  AVBufferPool *buffers;
+  AVBufferRef *buf;
+  int linesize, ret, i;
+
+  key.type = AVMEDIA_TYPE_AUDIO;
+  key.format = frame->format;
+  key.channels = channels;
+  key.nb_samples = frame->nb_samples;
+
+  ret = av_samples_get_buffer_size(&linesize, channels, frame->nb_samples,
+                                   frame->format, 0);
+  if (ret < 0)
+    return ret;
+
+  buffers = frame_pool_find(pool, &key, linesize);
+  if (!buffers)
+    return AVERROR(ENOMEM);
+
+  // Planes past AV_NUM_DATA_POINTERS go in extended_buf, as ffmpeg does.
+  if (planes > AV_NUM_DATA_POINTERS) {
+    frame->extended_data = av_calloc(planes, sizeof(*frame->extended_data));
+    frame->extended_buf =
+        av_calloc(planes - AV_NUM_DATA_POINTERS, sizeof(*frame->extended_buf));
+    if (!frame->extended_data || !frame->extended_buf) {
+      av_freep(&frame->extended_data);
+      av_freep(&frame->extended_buf);
+      return AVERROR(ENOMEM);
+    }
+    frame->nb_extended_buf = planes - AV_NUM_DATA_POINTERS;
+  } else
+    frame->extended_data = frame->data;
+
+  for (i = 0; i < planes; i++) {
+    buf = av_buffer_pool_get(buffers);
+    if (!buf)
+      return AVERROR(ENOMEM);
+
+    if (i < AV_NUM_DATA_POINTERS) {
+      frame->buf[i] = buf;
+      frame->data[i] = buf->data;
+    } else
+      frame->extended_buf[i - AV_NUM_DATA_POINTERS] = buf;
+
+    frame->extended_data[i] = buf->data;
+  }
+
+  frame->linesize[0] = linesize;
+
+  return 0;
+}
+
+static void finalize_frame_pool(value v) { frame_pool_free(Frame_pool_val(v)); }
+
+static struct custom_operations frame_pool_ops = {
+    "ocaml_avutil_frame_pool",  finalize_frame_pool,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+CAMLprim value ocaml_avutil_frame_pool_create(value _max_shapes) {
+  CAMLparam1(_max_shapes);
+  CAMLlocal1(ans);
+  frame_pool_t *pool;
+
+  if (Int_val(_max_shapes) < 1)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  pool = frame_pool_alloc(Int_val(_max_shapes));
+  if (!pool)
+    caml_raise_out_of_memory();
+
+  ans = caml_alloc_custom(&frame_pool_ops, sizeof(frame_pool_t *), 0, 1);
+  Frame_pool_val(ans) = pool;
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_frame_pool_allocated(value _pool) {
+  CAMLparam1(_pool);
+  CAMLreturn(Val_int(Frame_pool_val(_pool)->allocated));
+}
+
+CAMLprim value ocaml_avutil_video_create_frame(value _pool, value _w, value _h,
                                                value _format) {
-  CAMLparam3(_w, _h, _format);
+  CAMLparam4(_pool, _w, _h, _format);
   CAMLlocal1(ans);
+  enum AVPixelFormat format = PixelFormat_val(_format);
+  int ret;
+
   AVFrame *frame = av_frame_alloc();
   if (!frame)
     caml_raise_out_of_memory();
 
-  frame->format = PixelFormat_val(_format);
+  frame->format = format;
   frame->width = Int_val(_w);
   frame->height = Int_val(_h);
 
-  int ret = av_frame_get_buffer(frame, 32);
+  if (_pool == Val_none)
+    ret = av_frame_get_buffer(frame, FRAME_POOL_ALIGN);
+  else
+    ret = frame_pool_get_video_buffer(Frame_pool_val(Some_val(_pool)), frame);
 
   if (ret < 0) {
     av_frame_free(&frame);
@@ -1055,11 +1694,11 @@ CAMLprim value ocaml_avutil_video_create_frame(value _w, value _h,
 }
 
 /* Adapted from alloc_audio_frame */
-CAMLprim value ocaml_avutil_audio_create_frame(value _sample_fmt,
+CAMLprim value ocaml_avutil_audio_create_frame(value _pool, value _sample_fmt,
                                                value _channel_layout,
                                                value _samplerate,
                                                value _samples) {
-  CAMLparam4(_sample_fmt, _channel_layout, _samplerate, _samples);
+  CAMLparam5(_pool, _sample_fmt, _channel_layout, _samplerate, _samples);
   CAMLlocal1(ans);
   enum AVSampleFormat sample_fmt = SampleFormat_val(_sample_fmt);
   AVChannelLayout *channel_layout = AVChannelLayout_val(_channel_layout);
@@ -1083,10 +1722,158 @@ CAMLprim value ocaml_avutil_audio_create_frame(value _sample_fmt,
   frame->sample_rate = sample_rate;
   frame->nb_samples = nb_samples;
 
-  ret = av_frame_get_buffer(frame, 0);
+  if (_pool == Val_none)
+    ret = av_frame_get_buffer(frame, 0);
+  else
+    ret = frame_pool_get_audio_buffer(Frame_pool_val(Some_val(_pool)), frame);
+
+  if (ret < 0) {
+    av_frame_free(&frame);
+    ocaml_avutil_raise_error(ret);
+  }
+
+  value_of_frame(&ans, frame);
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_video_frame_of_bigarrays(value _w, value _h,
+                                                    value _format,
+                                                    value _planes) {
+  CAMLparam4(_w, _h, _format, _planes);
+  CAMLlocal2(ans, plane);
+  enum AVPixelFormat format = PixelFormat_val(_format);
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+  int nb_planes = Wosize_val(_planes);
+  ptrdiff_t linesizes[4] = {0};
+  size_t sizes[4];
+  AVFrame *frame;
+  int i, ret;
+
+  collect_bigarray_buffers();
+
+  if (!desc || desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL) ||
+      nb_planes != av_pix_fmt_count_planes(format) ||
+      av_image_check_size(Int_val(_w), Int_val(_h)) < 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  for (i = 0; i < nb_planes; i++) {
+    linesizes[i] = Int_val(Field(Field(_planes, i), 1));
+    if (linesizes[i] < av_image_get_linesize(format, Int_val(_w), i))
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  ret = av_image_fill_plane_sizes(sizes, format, Int_val(_h), linesizes);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  for (i = 0; i < nb_planes; i++) {
+    plane = Field(Field(_planes, i), 0);
+    if ((size_t)Caml_ba_array_val(plane)->dim[0] < sizes[i])
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  frame = av_frame_alloc();
+  if (!frame)
+    caml_raise_out_of_memory();
+
+  frame->format = format;
+  frame->width = Int_val(_w);
+  frame->height = Int_val(_h);
+
+  for (i = 0; i < nb_planes; i++) {
+    plane = Field(Field(_planes, i), 0);
+
+    ret = bigarray_buffer(plane, &frame->buf[i]);
+    if (ret < 0) {
+      av_frame_free(&frame);
+      collect_bigarray_buffers();
+      ocaml_avutil_raise_error(ret);
+    }
+
+    frame->data[i] = Caml_ba_data_val(plane);
+    frame->linesize[i] = linesizes[i];
+  }
+
+  value_of_frame(&ans, frame);
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_audio_frame_of_bigarray(value _sample_fmt,
+                                                   value _channel_layout,
+                                                   value _sample_rate,
+                                                   value _planes) {
+  CAMLparam4(_sample_fmt, _channel_layout, _sample_rate, _planes);
+  CAMLlocal2(ans, plane);
+  enum AVSampleFormat sample_fmt = SampleFormat_val(_sample_fmt);
+  AVChannelLayout *channel_layout = AVChannelLayout_val(_channel_layout);
+  enum caml_ba_kind kind = bigarray_kind_of_AVSampleFormat(sample_fmt);
+  int channels = channel_layout->nb_channels;
+  int planar = av_sample_fmt_is_planar(sample_fmt);
+  int nb_planes = Wosize_val(_planes);
+  intnat len = 0;
+  AVFrame *frame;
+  int i, ret;
+
+  collect_bigarray_buffers();
+
+  if (channels <= 0 || nb_planes != (planar ? channels : 1))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  for (i = 0; i < nb_planes; i++) {
+    plane = Field(_planes, i);
+    if ((Caml_ba_array_val(plane)->flags & CAML_BA_KIND_MASK) != kind ||
+        (i > 0 && Caml_ba_array_val(plane)->dim[0] != len))
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+    len = Caml_ba_array_val(plane)->dim[0];
+  }
+
+  if (!planar && len % channels)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  if (len * av_get_bytes_per_sample(sample_fmt) > INT_MAX)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  frame = av_frame_alloc();
+  if (!frame)
+    caml_raise_out_of_memory();
+
+  frame->format = sample_fmt;
+  frame->sample_rate = Int_val(_sample_rate);
+  frame->nb_samples = len / (planar ? 1 : channels);
+  frame->linesize[0] = len * av_get_bytes_per_sample(sample_fmt);
+
+  ret = av_channel_layout_copy(&frame->ch_layout, channel_layout);
+
+  if (ret >= 0 && nb_planes > AV_NUM_DATA_POINTERS) {
+    frame->extended_data = av_calloc(nb_planes, sizeof(uint8_t *));
+    frame->extended_buf = av_calloc(nb_planes - AV_NUM_DATA_POINTERS,
+                                    sizeof(AVBufferRef *));
+    if (!frame->extended_data || !frame->extended_buf) {
+      if (!frame->extended_data)
+        frame->extended_data = frame->data;
+      ret = AVERROR(ENOMEM);
+    } else
+      frame->nb_extended_buf = nb_planes - AV_NUM_DATA_POINTERS;
+  }
+
+  for (i = 0; ret >= 0 && i < nb_planes; i++) {
+    plane = Field(_planes, i);
+
+    if (i < AV_NUM_DATA_POINTERS) {
+      ret = bigarray_buffer(plane, &frame->buf[i]);
+      frame->data[i] = Caml_ba_data_val(plane);
+    } else
+      ret = bigarray_buffer(plane,
+                            &frame->extended_buf[i - AV_NUM_DATA_POINTERS]);
+
+    frame->extended_data[i] = Caml_ba_data_val(plane);
+  }
 
   if (ret < 0) {
     av_frame_free(&frame);
+    collect_bigarray_buffers();
     ocaml_avutil_raise_error(ret);
   }
 
@@ -1169,10 +1956,1642 @@ CAMLprim value ocaml_avutil_audio_frame_copy_samples(value _src, value _src_ofs,
   CAMLreturn(Val_unit);
 }
 
-CAMLprim value ocaml_avutil_video_frame_width(value _frame) {
-  CAMLparam1(_frame);
+/***** Shared memory frames *****/
+
+/* Frames whose data lives in a single memfd mapping, so that other
+   processes can map it too. Live mappings are registered, which both tells
+   shared frames apart and keeps their fd at hand to export them. Layouts
+   are exchanged as a fixed-size blob naming formats by string, and data
+   pointers are recomputed from it on both sides. */
+
+#define SHM_MAGIC "OCFFSHM1"
+
+typedef struct {
+  char magic[8];
+  int32_t media_type;
+  char format[32];
+  int32_t width;
+  int32_t height;
+  char ch_layout[128];
+  int32_t sample_rate;
+  int32_t nb_samples;
+  int64_t pts;
+  int32_t time_base_num;
+  int32_t time_base_den;
+} shm_layout_t;
+
+#ifdef HAVE_SHM_FRAME
+
+typedef struct shm_mapping_t {
+  uint8_t *data;
+  size_t size;
+  int fd;
+  struct shm_mapping_t *next;
+} shm_mapping_t;
+
+static shm_mapping_t *shm_mappings = NULL;
+static pthread_mutex_t shm_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void shm_free(void *opaque, uint8_t *data) {
+  shm_mapping_t *m = opaque, **p;
+  (void)data;
+
+  pthread_mutex_lock(&shm_mutex);
+  for (p = &shm_mappings; *p; p = &(*p)->next)
+    if (*p == m) {
+      *p = m->next;
+      break;
+    }
+  pthread_mutex_unlock(&shm_mutex);
 
-  AVFrame *frame = Frame_val(_frame);
+  munmap(m->data, m->size);
+  close(m->fd);
+  av_free(m);
+}
+
+// Maps [size] bytes of [fd] into [*buf]. Takes [fd] over.
+static int shm_buffer(int fd, size_t size, AVBufferRef **buf) {
+  shm_mapping_t *m = av_mallocz(sizeof(shm_mapping_t));
+  int ret;
+
+  if (!m) {
+    close(fd);
+    return AVERROR(ENOMEM);
+  }
+
+  m->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (m->data == MAP_FAILED) {
+    ret = AVERROR(errno);
+    close(fd);
+    av_free(m);
+    return ret;
+  }
+
+  m->size = size;
+  m->fd = fd;
+
+  *buf = av_buffer_create(m->data, size, shm_free, m, 0);
+  if (!*buf) {
+    munmap(m->data, size);
+    close(fd);
+    av_free(m);
+    return AVERROR(ENOMEM);
+  }
+
+  pthread_mutex_lock(&shm_mutex);
+  m->next = shm_mappings;
+  shm_mappings = m;
+  pthread_mutex_unlock(&shm_mutex);
+
+  return 0;
+}
+
+static int is_shm_buffer(const AVBufferRef *buf) {
+  shm_mapping_t *m;
+  int found = 0;
+
+  if (!buf)
+    return 0;
+
+  pthread_mutex_lock(&shm_mutex);
+  for (m = shm_mappings; m && !found; m = m->next)
+    found = m->data == buf->data;
+  pthread_mutex_unlock(&shm_mutex);
+
+  return found;
+}
+
+/* Sets up [frame] as described by [layout]. Returns the size of the data,
+   with every plane at the offset [shm_frame_fill] puts it. */
+static int shm_frame_init(AVFrame *frame, const shm_layout_t *layout,
+                          enum AVMediaType media_type) {
+  char format[sizeof(layout->format)], ch_layout[sizeof(layout->ch_layout)];
+  int ret;
+
+  if (memcmp(layout->magic, SHM_MAGIC, sizeof(layout->magic)) ||
+      layout->media_type != media_type)
+    return AVERROR(EINVAL);
+
+  av_strlcpy(format, layout->format, sizeof(format));
+  frame->pts = layout->pts;
+  frame->time_base =
+      (AVRational){layout->time_base_num, layout->time_base_den};
+
+  if (media_type == AVMEDIA_TYPE_VIDEO) {
+    frame->format = av_get_pix_fmt(format);
+    frame->width = layout->width;
+    frame->height = layout->height;
+
+    if (frame->format == AV_PIX_FMT_NONE)
+      return AVERROR(EINVAL);
+
+    return av_image_get_buffer_size(frame->format, frame->width,
+                                    frame->height, FRAME_POOL_ALIGN);
+  }
+
+  av_strlcpy(ch_layout, layout->ch_layout, sizeof(ch_layout));
+  frame->format = av_get_sample_fmt(format);
+  frame->sample_rate = layout->sample_rate;
+  frame->nb_samples = layout->nb_samples;
+
+  ret = av_channel_layout_from_string(&frame->ch_layout, ch_layout);
+  if (ret < 0)
+    return ret;
+
+  if (frame->format == AV_SAMPLE_FMT_NONE ||
+      (av_sample_fmt_is_planar(frame->format) &&
+       frame->ch_layout.nb_channels > AV_NUM_DATA_POINTERS))
+    return AVERROR(EINVAL);
+
+  return av_samples_get_buffer_size(NULL, frame->ch_layout.nb_channels,
+                                    frame->nb_samples, frame->format,
+                                    FRAME_POOL_ALIGN);
+}
+
+static int shm_frame_fill(AVFrame *frame, uint8_t *data,
+                          uint8_t *planes[AV_NUM_DATA_POINTERS],
+                          int linesizes[AV_NUM_DATA_POINTERS]) {
+  memset(planes, 0, AV_NUM_DATA_POINTERS * sizeof(uint8_t *));
+  memset(linesizes, 0, AV_NUM_DATA_POINTERS * sizeof(int));
+
+  if (frame->width)
+    return av_image_fill_arrays(planes, linesizes, data, frame->format,
+                                frame->width, frame->height, FRAME_POOL_ALIGN);
+
+  return av_samples_fill_arrays(planes, linesizes, data,
+                                frame->ch_layout.nb_channels,
+                                frame->nb_samples, frame->format,
+                                FRAME_POOL_ALIGN);
+}
+
+/* Returns a frame described by [layout], on a new memfd if [fd] is
+   negative, on a mapping of [fd] otherwise. */
+static AVFrame *shm_frame_alloc(const shm_layout_t *layout,
+                                enum AVMediaType media_type, int fd,
+                                int *err) {
+  AVFrame *frame = av_frame_alloc();
+  AVBufferRef *buf = NULL;
+  struct stat st;
+  int size, ret;
+
+  if (!frame) {
+    *err = AVERROR(ENOMEM);
+    return NULL;
+  }
+
+  ret = shm_frame_init(frame, layout, media_type);
+  if (ret < 0)
+    goto fail;
+
+  if (ret > INT_MAX - FRAME_POOL_PADDING) {
+    ret = AVERROR(EINVAL);
+    goto fail;
+  }
+  size = ret + FRAME_POOL_PADDING;
+
+  /* A mapping past the end of the file faults on access: the size is sealed
+     so that no process can shrink it under another one's mapping. */
+  if (fd < 0) {
+    fd = memfd_create("ocaml-ffmpeg-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0 || ftruncate(fd, size) < 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0) {
+      ret = AVERROR(errno);
+      if (fd >= 0)
+        close(fd);
+      goto fail;
+    }
+  } else {
+    // Seals first: the size cannot change once they are checked.
+    ret = fcntl(fd, F_GET_SEALS);
+    if (ret < 0 || !(ret & F_SEAL_SHRINK) || fstat(fd, &st) < 0 ||
+        st.st_size < size) {
+      ret = AVERROR(EINVAL);
+      goto fail;
+    }
+
+    fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+      ret = AVERROR(errno);
+      goto fail;
+    }
+  }
+
+  ret = shm_buffer(fd, size, &buf);
+  if (ret < 0)
+    goto fail;
+
+  frame->buf[0] = buf;
+  ret = shm_frame_fill(frame, buf->data, frame->data, frame->linesize);
+  if (ret < 0)
+    goto fail;
+
+  return frame;
+
+fail:
+  av_frame_free(&frame);
+  *err = ret;
+  return NULL;
+}
+
+static int shm_describe_layout(const AVChannelLayout *ch_layout,
+                               shm_layout_t *layout) {
+  int ret = av_channel_layout_describe(ch_layout, layout->ch_layout,
+                                       sizeof(layout->ch_layout));
+
+  // Truncated descriptions would not parse back.
+  return ret < 0 || ret >= (int)sizeof(layout->ch_layout) ? AVERROR(EINVAL)
+                                                          : 0;
+}
+
+static value shm_frame_create(const shm_layout_t *layout,
+                              enum AVMediaType media_type, int fd) {
+  CAMLparam0();
+  CAMLlocal1(ans);
+  AVFrame *frame;
+  int err;
+
+  frame = shm_frame_alloc(layout, media_type, fd, &err);
+  if (!frame)
+    ocaml_avutil_raise_error(err);
+
+  value_of_frame(&ans, frame);
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_shm_frame_create_video(value _w, value _h,
+                                                   value _format) {
+  CAMLparam3(_w, _h, _format);
+  shm_layout_t layout = {.magic = SHM_MAGIC,
+                         .media_type = AVMEDIA_TYPE_VIDEO,
+                         .width = Int_val(_w),
+                         .height = Int_val(_h),
+                         .pts = AV_NOPTS_VALUE};
+  const char *name = av_get_pix_fmt_name(PixelFormat_val(_format));
+
+  if (!name)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+  av_strlcpy(layout.format, name, sizeof(layout.format));
+
+  CAMLreturn(shm_frame_create(&layout, AVMEDIA_TYPE_VIDEO, -1));
+}
+
+CAMLprim value ocaml_avutil_shm_frame_create_audio(value _sample_fmt,
+                                                   value _channel_layout,
+                                                   value _sample_rate,
+                                                   value _nb_samples) {
+  CAMLparam4(_sample_fmt, _channel_layout, _sample_rate, _nb_samples);
+  shm_layout_t layout = {.magic = SHM_MAGIC,
+                         .media_type = AVMEDIA_TYPE_AUDIO,
+                         .sample_rate = Int_val(_sample_rate),
+                         .nb_samples = Int_val(_nb_samples),
+                         .pts = AV_NOPTS_VALUE};
+  const char *name = av_get_sample_fmt_name(SampleFormat_val(_sample_fmt));
+
+  if (!name ||
+      shm_describe_layout(AVChannelLayout_val(_channel_layout), &layout) < 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+  av_strlcpy(layout.format, name, sizeof(layout.format));
+
+  CAMLreturn(shm_frame_create(&layout, AVMEDIA_TYPE_AUDIO, -1));
+}
+
+CAMLprim value ocaml_avutil_shm_frame_descriptor(value _frame) {
+  CAMLparam1(_frame);
+  CAMLlocal2(ans, blob);
+  AVFrame *frame = Frame_val(_frame);
+  uint8_t *planes[AV_NUM_DATA_POINTERS];
+  int linesizes[AV_NUM_DATA_POINTERS];
+  shm_layout_t layout = {.magic = SHM_MAGIC,
+                         .pts = frame->pts,
+                         .time_base_num = frame->time_base.num,
+                         .time_base_den = frame->time_base.den};
+  shm_mapping_t *m;
+  const char *name;
+  int fd = -1, err = EINVAL;
+
+  if (!frame->buf[0])
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  pthread_mutex_lock(&shm_mutex);
+  for (m = shm_mappings; m; m = m->next)
+    if (m->data == frame->buf[0]->data) {
+      fd = fcntl(m->fd, F_DUPFD_CLOEXEC, 0);
+      err = errno;
+      break;
+    }
+  pthread_mutex_unlock(&shm_mutex);
+
+  if (fd < 0)
+    ocaml_avutil_raise_error(AVERROR(err));
+
+  if (frame->width) {
+    layout.media_type = AVMEDIA_TYPE_VIDEO;
+    name = av_get_pix_fmt_name(frame->format);
+    layout.width = frame->width;
+    layout.height = frame->height;
+  } else {
+    layout.media_type = AVMEDIA_TYPE_AUDIO;
+    name = av_get_sample_fmt_name(frame->format);
+    layout.sample_rate = frame->sample_rate;
+    layout.nb_samples = frame->nb_samples;
+    if (shm_describe_layout(&frame->ch_layout, &layout) < 0)
+      name = NULL;
+  }
+
+  if (name)
+    av_strlcpy(layout.format, name, sizeof(layout.format));
+
+  /* The peer recomputes the planes from the layout: they must not have
+     moved, e.g. after cropping. */
+  if (!name || frame->buf[1] ||
+      shm_frame_fill(frame, frame->buf[0]->data, planes, linesizes) < 0 ||
+      memcmp(planes, frame->data, sizeof(planes)) ||
+      memcmp(linesizes, frame->linesize, sizeof(linesizes))) {
+    close(fd);
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  blob = caml_alloc_initialized_string(sizeof(layout), (const char *)&layout);
+
+  ans = caml_alloc_tuple(2);
+  Store_field(ans, 0, Val_int(fd));
+  Store_field(ans, 1, blob);
+
+  CAMLreturn(ans);
+}
+
+static void shm_layout_of_value(value _layout, shm_layout_t *layout) {
+  if (caml_string_length(_layout) != sizeof(shm_layout_t))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  memcpy(layout, String_val(_layout), sizeof(shm_layout_t));
+}
+
+CAMLprim value ocaml_avutil_shm_frame_map_video(value _descriptor) {
+  CAMLparam1(_descriptor);
+  shm_layout_t layout;
+
+  shm_layout_of_value(Field(_descriptor, 1), &layout);
+
+  CAMLreturn(shm_frame_create(&layout, AVMEDIA_TYPE_VIDEO,
+                              Int_val(Field(_descriptor, 0))));
+}
+
+CAMLprim value ocaml_avutil_shm_frame_map_audio(value _descriptor) {
+  CAMLparam1(_descriptor);
+  shm_layout_t layout;
+
+  shm_layout_of_value(Field(_descriptor, 1), &layout);
+
+  CAMLreturn(shm_frame_create(&layout, AVMEDIA_TYPE_AUDIO,
+                              Int_val(Field(_descriptor, 0))));
+}
+
+CAMLprim value ocaml_avutil_shm_frame_send(value _socket, value _descriptor) {
+  CAMLparam2(_socket, _descriptor);
+  int socket = Int_val(_socket), fd = Int_val(Field(_descriptor, 0));
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  shm_layout_t layout;
+  struct iovec iov = {&layout, sizeof(layout)};
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg;
+  ssize_t len;
+
+  shm_layout_of_value(Field(_descriptor, 1), &layout);
+
+  memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  caml_release_runtime_system();
+  do
+    len = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  while (len < 0 && errno == EINTR);
+  caml_acquire_runtime_system();
+
+  if (len < 0)
+    ocaml_avutil_raise_error(AVERROR(errno));
+
+  if (len != sizeof(layout))
+    ocaml_avutil_raise_error(AVERROR(EIO));
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avutil_shm_frame_receive(value _socket) {
+  CAMLparam1(_socket);
+  CAMLlocal2(ans, blob);
+  int socket = Int_val(_socket), fd = -1;
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  shm_layout_t layout;
+  struct iovec iov = {&layout, sizeof(layout)};
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg;
+  ssize_t len;
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  caml_release_runtime_system();
+  do
+    len = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+  while (len < 0 && errno == EINTR);
+  caml_acquire_runtime_system();
+
+  if (len < 0)
+    ocaml_avutil_raise_error(AVERROR(errno));
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+  if (len == 0 && fd < 0)
+    caml_raise_end_of_file();
+
+  if (len != sizeof(layout) || fd < 0 || (msg.msg_flags & MSG_CTRUNC)) {
+    if (fd >= 0)
+      close(fd);
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  blob = caml_alloc_initialized_string(sizeof(layout), (const char *)&layout);
+
+  ans = caml_alloc_tuple(2);
+  Store_field(ans, 0, Val_int(fd));
+  Store_field(ans, 1, blob);
+
+  CAMLreturn(ans);
+}
+
+#else
+
+static int is_shm_buffer(const AVBufferRef *buf) {
+  (void)buf;
+  return 0;
+}
+
+#define Shm_frame_unsupported(name, ...)                                       \
+  CAMLprim value name(__VA_ARGS__) {                                           \
+    ocaml_avutil_raise_error(AVERROR(ENOSYS));                                 \
+    return Val_unit;                                                           \
+  }
+
+Shm_frame_unsupported(ocaml_avutil_shm_frame_create_video, value _w, value _h,
+                      value _format)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_create_audio, value _sample_fmt,
+                      value _channel_layout, value _sample_rate,
+                      value _nb_samples)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_descriptor, value _frame)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_map_video, value _descriptor)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_map_audio, value _descriptor)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_send, value _socket,
+                      value _descriptor)
+Shm_frame_unsupported(ocaml_avutil_shm_frame_receive, value _socket)
+
+#endif
+
+/***** Audio DSP *****/
+
+/* Kernels work on 32-bit float. Float frames are processed in place, other
+   sample formats go through blocks of DSP_BLOCK converted samples. FFmpeg
+   does not install float_dsp.h, hence the vector extensions below, which
+   GCC and clang lower to the target's SIMD instructions. */
+
+#define DSP_BLOCK 1024
+
+#ifdef __GNUC__
+#define DSP_VECTOR
+typedef float dsp_vec_t __attribute__((vector_size(16)));
+#define DSP_VEC_LEN 4
+#endif
+
+// Unaligned, aliasing-safe vector loads and stores.
+#define Dsp_load(v, p) memcpy(&(v), (p), sizeof(dsp_vec_t))
+#define Dsp_store(p, v) memcpy((p), &(v), sizeof(dsp_vec_t))
+
+// dst[i] = src[i] * mul, [dst] may be [src].
+static void dsp_fmul_scalar(float *dst, const float *src, float mul, int len) {
+  int i = 0;
+
+#ifdef DSP_VECTOR
+  dsp_vec_t v, m = {mul, mul, mul, mul};
+
+  for (; i + DSP_VEC_LEN <= len; i += DSP_VEC_LEN) {
+    Dsp_load(v, src + i);
+    v *= m;
+    Dsp_store(dst + i, v);
+  }
+#endif
+
+  for (; i < len; i++)
+    dst[i] = src[i] * mul;
+}
+
+// dst[i] += src[i] * mul
+static void dsp_fmac_scalar(float *dst, const float *src, float mul, int len) {
+  int i = 0;
+
+#ifdef DSP_VECTOR
+  dsp_vec_t v, d, m = {mul, mul, mul, mul};
+
+  for (; i + DSP_VEC_LEN <= len; i += DSP_VEC_LEN) {
+    Dsp_load(v, src + i);
+    Dsp_load(d, dst + i);
+    d += v * m;
+    Dsp_store(dst + i, d);
+  }
+#endif
+
+  for (; i < len; i++)
+    dst[i] += src[i] * mul;
+}
+
+// data[i] *= gain + step * i
+static void dsp_fmul_ramp(float *data, float gain, float step, int len) {
+  int i = 0;
+
+#ifdef DSP_VECTOR
+  dsp_vec_t v, g, s = {step, step, step, step};
+
+  for (; i + DSP_VEC_LEN <= len; i += DSP_VEC_LEN) {
+    g = (dsp_vec_t){i, i + 1, i + 2, i + 3} * s + gain;
+    Dsp_load(v, data + i);
+    v *= g;
+    Dsp_store(data + i, v);
+  }
+#endif
+
+  for (; i < len; i++)
+    data[i] *= gain + step * i;
+}
+
+// Sum of squares, in float per block so that it vectorizes.
+static double dsp_sum_squares(const float *data, int len) {
+  float sum = 0;
+  int i = 0;
+
+#ifdef DSP_VECTOR
+  dsp_vec_t v, acc = {0, 0, 0, 0};
+
+  for (; i + DSP_VEC_LEN <= len; i += DSP_VEC_LEN) {
+    Dsp_load(v, data + i);
+    acc += v * v;
+  }
+
+  sum = acc[0] + acc[1] + acc[2] + acc[3];
+#endif
+
+  for (; i < len; i++)
+    sum += data[i] * data[i];
+
+  return sum;
+}
+
+static void dsp_load(enum AVSampleFormat fmt, const uint8_t *src, int offset,
+                     float *dst, int len) {
+  int i;
+
+  switch (av_get_packed_sample_fmt(fmt)) {
+  case AV_SAMPLE_FMT_U8:
+    for (i = 0; i < len; i++)
+      dst[i] = (src[offset + i] - 128) * (1.f / 128);
+    break;
+  case AV_SAMPLE_FMT_S16:
+    for (i = 0; i < len; i++)
+      dst[i] = ((const int16_t *)src)[offset + i] * (1.f / 32768);
+    break;
+  case AV_SAMPLE_FMT_S32:
+    for (i = 0; i < len; i++)
+      dst[i] = ((const int32_t *)src)[offset + i] * (1.f / 2147483648.f);
+    break;
+  case AV_SAMPLE_FMT_S64:
+    for (i = 0; i < len; i++)
+      dst[i] = ((const int64_t *)src)[offset + i] / 9223372036854775808.;
+    break;
+  case AV_SAMPLE_FMT_FLT:
+    memcpy(dst, (const float *)src + offset, len * sizeof(float));
+    break;
+  case AV_SAMPLE_FMT_DBL:
+    for (i = 0; i < len; i++)
+      dst[i] = ((const double *)src)[offset + i];
+    break;
+  default:
+    break;
+  }
+}
+
+// Integer formats saturate.
+static void dsp_store(enum AVSampleFormat fmt, const float *src, uint8_t *dst,
+                      int offset, int len) {
+  double d;
+  int i;
+
+  switch (av_get_packed_sample_fmt(fmt)) {
+  case AV_SAMPLE_FMT_U8:
+    for (i = 0; i < len; i++)
+      dst[offset + i] =
+          av_clip_uint8(lrintf(av_clipf(src[i], -1, 1) * 128) + 128);
+    break;
+  case AV_SAMPLE_FMT_S16:
+    for (i = 0; i < len; i++)
+      ((int16_t *)dst)[offset + i] =
+          av_clip_int16(lrintf(av_clipf(src[i], -1, 1) * 32768));
+    break;
+  case AV_SAMPLE_FMT_S32:
+    for (i = 0; i < len; i++)
+      ((int32_t *)dst)[offset + i] =
+          av_clipl_int32(llrint(av_clipd(src[i], -1, 1) * 2147483648.));
+    break;
+  case AV_SAMPLE_FMT_S64:
+    for (i = 0; i < len; i++) {
+      d = av_clipd(src[i], -1, 1) * 9223372036854775808.;
+      ((int64_t *)dst)[offset + i] =
+          d >= 9223372036854775807. ? INT64_MAX : llrint(d);
+    }
+    break;
+  case AV_SAMPLE_FMT_FLT:
+    memcpy((float *)dst + offset, src, len * sizeof(float));
+    break;
+  case AV_SAMPLE_FMT_DBL:
+    for (i = 0; i < len; i++)
+      ((double *)dst)[offset + i] = src[i];
+    break;
+  default:
+    break;
+  }
+}
+
+/* A frame as planes of [len] elements, [stride] of them per sample: one
+   plane per channel for planar formats, a single interleaved one
+   otherwise. */
+typedef struct {
+  enum AVSampleFormat fmt;
+  int planes;
+  int stride;
+  int len;
+} dsp_layout_t;
+
+static dsp_layout_t dsp_layout(AVFrame *frame) {
+  dsp_layout_t layout;
+  int channels = frame->ch_layout.nb_channels;
+  int planar = av_sample_fmt_is_planar(frame->format);
+
+  // Raises on formats with no known sample type.
+  bigarray_kind_of_AVSampleFormat(frame->format);
+
+  layout.fmt = frame->format;
+  layout.planes = planar ? channels : 1;
+  layout.stride = planar ? 1 : channels;
+  layout.len = frame->nb_samples * layout.stride;
+
+  return layout;
+}
+
+#define Dsp_is_float(fmt) (av_get_packed_sample_fmt(fmt) == AV_SAMPLE_FMT_FLT)
+
+/* Gain goes from [gain] on the first sample of the plane by [step] per
+   sample. */
+static void dsp_ramp_block(float *data, int first, int len, int stride,
+                           float gain, float step) {
+  int i;
+
+  if (step == 0)
+    dsp_fmul_scalar(data, data, gain, len);
+  else if (stride == 1)
+    dsp_fmul_ramp(data, gain + step * first, step, len);
+  else
+    for (i = 0; i < len; i++)
+      data[i] *= gain + step * ((first + i) / stride);
+}
+
+static void dsp_ramp(AVFrame *frame, dsp_layout_t *l, float gain, float step) {
+  float block[DSP_BLOCK];
+  int p, i, n;
+
+  for (p = 0; p < l->planes; p++) {
+    if (Dsp_is_float(l->fmt)) {
+      dsp_ramp_block((float *)frame->extended_data[p], 0, l->len, l->stride,
+                     gain, step);
+      continue;
+    }
+
+    for (i = 0; i < l->len; i += n) {
+      n = FFMIN(DSP_BLOCK, l->len - i);
+      dsp_load(l->fmt, frame->extended_data[p], i, block, n);
+      dsp_ramp_block(block, i, n, l->stride, gain, step);
+      dsp_store(l->fmt, block, frame->extended_data[p], i, n);
+    }
+  }
+}
+
+CAMLprim value ocaml_avutil_audio_frame_ramp(value _frame, value _from,
+                                             value _to) {
+  CAMLparam3(_frame, _from, _to);
+  AVFrame *frame = Frame_val(_frame);
+  dsp_layout_t layout = dsp_layout(frame);
+  float from = Double_val(_from);
+  float step =
+      frame->nb_samples ? (Double_val(_to) - from) / frame->nb_samples : 0;
+  int ret;
+
+  ret = ocaml_avutil_frame_make_writable(frame);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  caml_release_runtime_system();
+  dsp_ramp(frame, &layout, from, step);
+  caml_acquire_runtime_system();
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avutil_audio_mix(value _pool, value _inputs,
+                                      value _gains) {
+  CAMLparam3(_pool, _inputs, _gains);
+  CAMLlocal1(ans);
+  int nb_inputs = Wosize_val(_inputs);
+  float acc[DSP_BLOCK], block[DSP_BLOCK];
+  AVFrame **inputs, *frame, *first;
+  dsp_layout_t l;
+  float *gains;
+  int k, p, i, n, ret;
+
+  if (nb_inputs == 0 || Wosize_val(_gains) / Double_wosize != nb_inputs)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  first = Frame_val(Field(_inputs, 0));
+  l = dsp_layout(first);
+
+  for (k = 1; k < nb_inputs; k++) {
+    frame = Frame_val(Field(_inputs, k));
+    if (frame->format != first->format ||
+        frame->nb_samples != first->nb_samples ||
+        av_channel_layout_compare(&frame->ch_layout, &first->ch_layout))
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  frame = av_frame_alloc();
+  if (!frame)
+    caml_raise_out_of_memory();
+
+  frame->format = first->format;
+  frame->sample_rate = first->sample_rate;
+  frame->nb_samples = first->nb_samples;
+  frame->pts = first->pts;
+  frame->time_base = first->time_base;
+
+  ret = av_channel_layout_copy(&frame->ch_layout, &first->ch_layout);
+  if (ret >= 0) {
+    if (_pool == Val_none)
+      ret = av_frame_get_buffer(frame, 0);
+    else
+      ret = frame_pool_get_audio_buffer(Frame_pool_val(Some_val(_pool)), frame);
+  }
+
+  if (ret < 0) {
+    av_frame_free(&frame);
+    ocaml_avutil_raise_error(ret);
+  }
+
+  inputs = av_malloc_array(nb_inputs, sizeof(AVFrame *));
+  gains = av_malloc_array(nb_inputs, sizeof(float));
+  if (!inputs || !gains) {
+    av_free(inputs);
+    av_free(gains);
+    av_frame_free(&frame);
+    caml_raise_out_of_memory();
+  }
+
+  for (k = 0; k < nb_inputs; k++) {
+    inputs[k] = Frame_val(Field(_inputs, k));
+    gains[k] = Double_flat_field(_gains, k);
+  }
+
+  // [_inputs] is rooted: the frames cannot be finalized meanwhile.
+  caml_release_runtime_system();
+
+  for (p = 0; p < l.planes; p++) {
+    if (Dsp_is_float(l.fmt)) {
+      dsp_fmul_scalar((float *)frame->extended_data[p],
+                      (const float *)inputs[0]->extended_data[p], gains[0],
+                      l.len);
+      for (k = 1; k < nb_inputs; k++)
+        dsp_fmac_scalar((float *)frame->extended_data[p],
+                        (const float *)inputs[k]->extended_data[p], gains[k],
+                        l.len);
+      continue;
+    }
+
+    for (i = 0; i < l.len; i += n) {
+      n = FFMIN(DSP_BLOCK, l.len - i);
+      dsp_load(l.fmt, inputs[0]->extended_data[p], i, acc, n);
+      dsp_fmul_scalar(acc, acc, gains[0], n);
+      for (k = 1; k < nb_inputs; k++) {
+        dsp_load(l.fmt, inputs[k]->extended_data[p], i, block, n);
+        dsp_fmac_scalar(acc, block, gains[k], n);
+      }
+      dsp_store(l.fmt, acc, frame->extended_data[p], i, n);
+    }
+  }
+
+  caml_acquire_runtime_system();
+
+  av_free(inputs);
+  av_free(gains);
+
+  value_of_frame(&ans, frame);
+
+  CAMLreturn(ans);
+}
+
+/* Per channel peak and sum of squares of [frame] into [peaks] and
+   [squares], which must be zeroed. */
+static void dsp_levels(AVFrame *frame, dsp_layout_t *l, double *peaks,
+                       double *squares) {
+  float buffer[DSP_BLOCK], *block, x;
+  int p, i, j, n, c;
+
+  for (p = 0; p < l->planes; p++) {
+    for (i = 0; i < l->len; i += n) {
+      n = FFMIN(DSP_BLOCK, l->len - i);
+
+      if (Dsp_is_float(l->fmt))
+        block = (float *)frame->extended_data[p] + i;
+      else {
+        dsp_load(l->fmt, frame->extended_data[p], i, buffer, n);
+        block = buffer;
+      }
+
+      if (l->stride == 1)
+        squares[p] += dsp_sum_squares(block, n);
+
+      for (j = 0; j < n; j++) {
+        c = l->stride == 1 ? p : (i + j) % l->stride;
+        x = fabsf(block[j]);
+        if (x > peaks[c])
+          peaks[c] = x;
+        if (l->stride != 1)
+          squares[c] += x * x;
+      }
+    }
+  }
+}
+
+CAMLprim value ocaml_avutil_audio_frame_levels(value _frame) {
+  CAMLparam1(_frame);
+  CAMLlocal2(ans, level);
+  AVFrame *frame = Frame_val(_frame);
+  dsp_layout_t layout = dsp_layout(frame);
+  int channels = frame->ch_layout.nb_channels;
+  double *peaks, *squares;
+  int c;
+
+  peaks = av_calloc(2 * FFMAX(channels, 1), sizeof(double));
+  if (!peaks)
+    caml_raise_out_of_memory();
+  squares = peaks + channels;
+
+  caml_release_runtime_system();
+  dsp_levels(frame, &layout, peaks, squares);
+  caml_acquire_runtime_system();
+
+  ans = caml_alloc_tuple(channels);
+
+  for (c = 0; c < channels; c++) {
+    // { peak; rms }: a float record.
+    level = caml_alloc(2 * Double_wosize, Double_array_tag);
+    Store_double_field(level, 0, peaks[c]);
+    Store_double_field(
+        level, 1,
+        frame->nb_samples ? sqrt(squares[c] / frame->nb_samples) : 0);
+    Store_field(ans, c, level);
+  }
+
+  av_free(peaks);
+
+  CAMLreturn(ans);
+}
+
+/***** Loudness *****/
+
+/* ITU-R BS.1770 K-weighting: a high shelf then a high pass, combined into
+   one fourth order filter per channel, as libebur128 does. */
+typedef struct {
+  int sample_rate;
+  int channels;
+  double b[5];
+  double a[5];
+  // Per channel: weight, then the filter's state.
+  double *weights;
+  double (*state)[5];
+} loudness_t;
+
+#define Loudness_val(v) (*(loudness_t **)Data_custom_val(v))
+
+static void loudness_init_filter(loudness_t *m) {
+  double f0 = 1681.974450955533, G = 3.999843853973347,
+         Q = 0.7071752369554196;
+  double K = tan(M_PI * f0 / m->sample_rate);
+  double Vh = pow(10.0, G / 20.0), Vb = pow(Vh, 0.4996667741545416);
+  double a0 = 1.0 + K / Q + K * K;
+  double pb[3] = {(Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0,
+                  (Vh - Vb * K / Q + K * K) / a0};
+  double pa[3] = {1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0};
+  double rb[3] = {1.0, -2.0, 1.0}, ra[3];
+
+  f0 = 38.13547087602444;
+  Q = 0.5003270373238773;
+  K = tan(M_PI * f0 / m->sample_rate);
+  ra[0] = 1.0;
+  ra[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
+  ra[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
+
+  m->b[0] = pb[0] * rb[0];
+  m->b[1] = pb[0] * rb[1] + pb[1] * rb[0];
+  m->b[2] = pb[0] * rb[2] + pb[1] * rb[1] + pb[2] * rb[0];
+  m->b[3] = pb[1] * rb[2] + pb[2] * rb[1];
+  m->b[4] = pb[2] * rb[2];
+
+  m->a[0] = pa[0] * ra[0];
+  m->a[1] = pa[0] * ra[1] + pa[1] * ra[0];
+  m->a[2] = pa[0] * ra[2] + pa[1] * ra[1] + pa[2] * ra[0];
+  m->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
+  m->a[4] = pa[2] * ra[2];
+}
+
+static void finalize_loudness(value v) {
+  loudness_t *m = Loudness_val(v);
+
+  av_free(m->weights);
+  av_free(m->state);
+  av_free(m);
+}
+
+static struct custom_operations loudness_ops = {
+    "ocaml_avutil_loudness",    finalize_loudness,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+CAMLprim value ocaml_avutil_audio_loudness_create(value _channel_layout,
+                                                  value _sample_rate) {
+  CAMLparam2(_channel_layout, _sample_rate);
+  CAMLlocal1(ans);
+  AVChannelLayout *layout = AVChannelLayout_val(_channel_layout);
+  enum AVChannel channel;
+  loudness_t *m;
+  int c;
+
+  if (Int_val(_sample_rate) <= 0 || layout->nb_channels <= 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  m = av_mallocz(sizeof(loudness_t));
+  if (!m)
+    caml_raise_out_of_memory();
+
+  m->sample_rate = Int_val(_sample_rate);
+  m->channels = layout->nb_channels;
+  m->weights = av_calloc(m->channels, sizeof(double));
+  m->state = av_calloc(m->channels, sizeof(*m->state));
+
+  if (!m->weights || !m->state) {
+    av_free(m->weights);
+    av_free(m->state);
+    av_free(m);
+    caml_raise_out_of_memory();
+  }
+
+  loudness_init_filter(m);
+
+  // BS.1770 channel weights: LFE is left out, surrounds count +1.5dB.
+  for (c = 0; c < m->channels; c++) {
+    channel = av_channel_layout_channel_from_index(layout, c);
+    switch (channel) {
+    case AV_CHAN_LOW_FREQUENCY:
+    case AV_CHAN_LOW_FREQUENCY_2:
+      m->weights[c] = 0.0;
+      break;
+    case AV_CHAN_SIDE_LEFT:
+    case AV_CHAN_SIDE_RIGHT:
+    case AV_CHAN_BACK_LEFT:
+    case AV_CHAN_BACK_RIGHT:
+      m->weights[c] = 1.41;
+      break;
+    default:
+      m->weights[c] = 1.0;
+    }
+  }
+
+  ans = caml_alloc_custom(&loudness_ops, sizeof(loudness_t *), 0, 1);
+  Loudness_val(ans) = m;
+
+  CAMLreturn(ans);
+}
+
+static double loudness_process(loudness_t *m, AVFrame *frame,
+                               dsp_layout_t *l) {
+  float block[DSP_BLOCK];
+  double *squares, *v, x, y, sum = 0;
+  int p, i, j, n, c;
+
+  squares = av_calloc(m->channels, sizeof(double));
+  if (!squares)
+    return NAN;
+
+  for (p = 0; p < l->planes; p++) {
+    for (i = 0; i < l->len; i += n) {
+      n = FFMIN(DSP_BLOCK, l->len - i);
+      dsp_load(l->fmt, frame->extended_data[p], i, block, n);
+
+      for (j = 0; j < n; j++) {
+        c = l->stride == 1 ? p : (i + j) % l->stride;
+        v = m->state[c];
+
+        // Direct form II.
+        v[0] = block[j] - m->a[1] * v[1] - m->a[2] * v[2] - m->a[3] * v[3] -
+               m->a[4] * v[4];
+        y = m->b[0] * v[0] + m->b[1] * v[1] + m->b[2] * v[2] +
+            m->b[3] * v[3] + m->b[4] * v[4];
+        v[4] = v[3];
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+
+        squares[c] += y * y;
+      }
+    }
+  }
+
+  for (c = 0; c < m->channels; c++)
+    sum += m->weights[c] * squares[c];
+
+  av_free(squares);
+
+  x = sum / frame->nb_samples;
+
+  return x > 0 ? -0.691 + 10.0 * log10(x) : -INFINITY;
+}
+
+CAMLprim value ocaml_avutil_audio_loudness_process(value _meter,
+                                                   value _frame) {
+  CAMLparam2(_meter, _frame);
+  loudness_t *m = Loudness_val(_meter);
+  AVFrame *frame = Frame_val(_frame);
+  dsp_layout_t layout = dsp_layout(frame);
+  double ans;
+
+  if (frame->ch_layout.nb_channels != m->channels ||
+      (frame->sample_rate && frame->sample_rate != m->sample_rate) ||
+      frame->nb_samples <= 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  caml_release_runtime_system();
+  ans = loudness_process(m, frame, &layout);
+  caml_acquire_runtime_system();
+
+  if (isnan(ans))
+    caml_raise_out_of_memory();
+
+  CAMLreturn(caml_copy_double(ans));
+}
+
+CAMLprim value ocaml_avutil_audio_loudness_reset(value _meter) {
+  CAMLparam1(_meter);
+  loudness_t *m = Loudness_val(_meter);
+
+  memset(m->state, 0, m->channels * sizeof(*m->state));
+
+  CAMLreturn(Val_unit);
+}
+
+/***** Fingerprints *****/
+
+// Visible rows of [plane], [*bytes] bytes each.
+static int fingerprint_plane_rows(const AVFrame *frame,
+                                  const AVPixFmtDescriptor *desc, int plane,
+                                  int *bytes) {
+  *bytes = av_image_get_linesize(frame->format, frame->width, plane);
+
+  if (plane == 1 || plane == 2)
+    return AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h);
+
+  return frame->height;
+}
+
+static int fingerprint_check(const AVFrame *frame) {
+  const AVPixFmtDescriptor *desc;
+
+  if (frame->width > 0) {
+    desc = av_pix_fmt_desc_get(frame->format);
+    if (!desc || !frame->data[0] ||
+        desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                       AV_PIX_FMT_FLAG_BAYER))
+      return AVERROR(EINVAL);
+    return AVMEDIA_TYPE_VIDEO;
+  }
+
+  if (frame->nb_samples > 0 && frame->extended_data &&
+      frame->extended_data[0] && frame->ch_layout.nb_channels > 0 &&
+      av_get_bytes_per_sample(frame->format) > 0)
+    return AVMEDIA_TYPE_AUDIO;
+
+  return AVERROR(EINVAL);
+}
+
+static void fingerprint_update(struct AVMurmur3 *hash, AVFrame *frame,
+                               int media_type) {
+  const AVPixFmtDescriptor *desc;
+  int32_t header[4];
+  int p, y, rows, bytes, planes;
+
+  header[0] = media_type;
+  header[1] = frame->format;
+
+  if (media_type == AVMEDIA_TYPE_VIDEO) {
+    header[2] = frame->width;
+    header[3] = frame->height;
+    av_murmur3_update(hash, (const uint8_t *)header, sizeof(header));
+
+    desc = av_pix_fmt_desc_get(frame->format);
+    planes = av_pix_fmt_count_planes(frame->format);
+
+    for (p = 0; p < planes; p++) {
+      rows = fingerprint_plane_rows(frame, desc, p, &bytes);
+      for (y = 0; y < rows; y++)
+        av_murmur3_update(hash, frame->data[p] + y * frame->linesize[p],
+                          bytes);
+    }
+
+    // Indices mean nothing without their colours.
+    if (desc->flags & AV_PIX_FMT_FLAG_PAL && frame->data[1])
+      av_murmur3_update(hash, frame->data[1], AVPALETTE_SIZE);
+
+    return;
+  }
+
+  header[2] = frame->ch_layout.nb_channels;
+  header[3] = frame->nb_samples;
+  av_murmur3_update(hash, (const uint8_t *)header, sizeof(header));
+
+  planes = av_sample_fmt_is_planar(frame->format)
+               ? frame->ch_layout.nb_channels
+               : 1;
+  bytes = frame->nb_samples * av_get_bytes_per_sample(frame->format) *
+          (planes == 1 ? frame->ch_layout.nb_channels : 1);
+
+  for (p = 0; p < planes; p++)
+    av_murmur3_update(hash, frame->extended_data[p], bytes);
+}
+
+CAMLprim value ocaml_avutil_frame_fingerprint(value _frame) {
+  CAMLparam1(_frame);
+  AVFrame *frame = Frame_val(_frame);
+  struct AVMurmur3 *hash;
+  uint8_t digest[16];
+  int64_t ans;
+  int media_type = fingerprint_check(frame);
+
+  if (media_type < 0)
+    ocaml_avutil_raise_error(media_type);
+
+  hash = av_murmur3_alloc();
+  if (!hash)
+    caml_raise_out_of_memory();
+
+  caml_release_runtime_system();
+  av_murmur3_init(hash);
+  fingerprint_update(hash, frame, media_type);
+  av_murmur3_final(hash, digest);
+  caml_acquire_runtime_system();
+
+  av_free(hash);
+  memcpy(&ans, digest, sizeof(ans));
+
+  CAMLreturn(caml_copy_int64(ans));
+}
+
+/* Perceptual hashes are difference hashes: bit [i] tells whether the
+   signal rises between two neighbouring cells of a coarse grid, which
+   survives re-encoding, rescaling and small level changes. Video cells are
+   mean luma over a 9x8 grid, estimated from a few lines per row of cells.
+   Audio cells are the energy of 65 consecutive slices of the frame. */
+
+#define PHASH_COLS 9
+#define PHASH_ROWS 8
+#define PHASH_LINES 8
+#define PHASH_SLICES 65
+
+static int video_perceptual_hash(AVFrame *frame, uint64_t *ans) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+  int pal = desc->flags & AV_PIX_FMT_FLAG_PAL;
+  int rgb = !pal && (desc->flags & AV_PIX_FMT_FLAG_RGB);
+  int nb_comps = rgb ? 3 : 1;
+  // Native-endian ARGB entries.
+  const uint32_t *palette = (const uint32_t *)frame->data[1];
+  uint32_t entry;
+  uint64_t sums[PHASH_ROWS][PHASH_COLS] = {{0}};
+  uint64_t counts[PHASH_ROWS][PHASH_COLS] = {{0}};
+  const uint8_t *data[4];
+  uint16_t *lines;
+  int linesize[4];
+  int w = frame->width, h = frame->height;
+  int r, c, i, k, x, y, y0, y1, n, luma;
+  uint64_t hash = 0;
+
+  if (pal && !palette)
+    return AVERROR(EINVAL);
+
+  lines = av_malloc_array(w, 3 * sizeof(uint16_t));
+  if (!lines)
+    return AVERROR(ENOMEM);
+
+  for (i = 0; i < 4; i++) {
+    data[i] = frame->data[i];
+    linesize[i] = frame->linesize[i];
+  }
+
+  for (r = 0; r < PHASH_ROWS; r++) {
+    y0 = r * h / PHASH_ROWS;
+    y1 = FFMAX((r + 1) * h / PHASH_ROWS, y0 + 1);
+    n = FFMIN(PHASH_LINES, y1 - y0);
+
+    for (k = 0; k < n; k++) {
+      y = y0 + k * (y1 - y0) / n;
+
+      // Palette indices are read as such and looked up below.
+      for (i = 0; i < nb_comps; i++)
+        av_read_image_line2(lines + i * w, data, linesize, desc, 0, y, i, w, 0,
+                            2);
+
+      for (x = 0; x < w; x++) {
+        if (pal) {
+          entry = palette[lines[x]];
+          luma = (((entry >> 16) & 0xff) * 2 + ((entry >> 8) & 0xff) * 5 +
+                  (entry & 0xff))
+                 << 5;
+        } else if (!rgb)
+          luma = lines[x] << (16 - desc->comp[0].depth);
+        else
+          luma = (((lines[x] << (16 - desc->comp[0].depth)) * 2) +
+                  ((lines[w + x] << (16 - desc->comp[1].depth)) * 5) +
+                  (lines[2 * w + x] << (16 - desc->comp[2].depth))) >>
+                 3;
+
+        c = x * PHASH_COLS / w;
+        sums[r][c] += luma;
+        counts[r][c]++;
+      }
+    }
+  }
+
+  av_free(lines);
+
+  for (r = 0; r < PHASH_ROWS; r++)
+    for (c = 0; c < PHASH_COLS - 1; c++)
+      // Compares means, cross-multiplied.
+      if (sums[r][c] * FFMAX(counts[r][c + 1], 1) <
+          sums[r][c + 1] * FFMAX(counts[r][c], 1))
+        hash |= UINT64_C(1) << (r * (PHASH_COLS - 1) + c);
+
+  *ans = hash;
+  return 0;
+}
+
+static void audio_perceptual_hash(AVFrame *frame, dsp_layout_t *l,
+                                  uint64_t *ans) {
+  double energy[PHASH_SLICES] = {0};
+  float block[DSP_BLOCK];
+  int64_t sample;
+  int p, i, j, n;
+  uint64_t hash = 0;
+
+  for (p = 0; p < l->planes; p++)
+    for (i = 0; i < l->len; i += n) {
+      n = FFMIN(DSP_BLOCK, l->len - i);
+      dsp_load(l->fmt, frame->extended_data[p], i, block, n);
+      for (j = 0; j < n; j++) {
+        sample = (i + j) / l->stride;
+        energy[sample * PHASH_SLICES / frame->nb_samples] +=
+            block[j] * block[j];
+      }
+    }
+
+  for (i = 0; i < PHASH_SLICES - 1; i++)
+    if (energy[i] < energy[i + 1])
+      hash |= UINT64_C(1) << i;
+
+  *ans = hash;
+}
+
+CAMLprim value ocaml_avutil_frame_perceptual_hash(value _frame) {
+  CAMLparam1(_frame);
+  AVFrame *frame = Frame_val(_frame);
+  int media_type = fingerprint_check(frame);
+  const AVPixFmtDescriptor *desc;
+  dsp_layout_t layout;
+  uint64_t ans;
+  int ret = 0;
+
+  if (media_type < 0)
+    ocaml_avutil_raise_error(media_type);
+
+  if (media_type == AVMEDIA_TYPE_VIDEO) {
+    desc = av_pix_fmt_desc_get(frame->format);
+    if (desc->flags & AV_PIX_FMT_FLAG_FLOAT)
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+  } else
+    layout = dsp_layout(frame);
+
+  caml_release_runtime_system();
+  if (media_type == AVMEDIA_TYPE_VIDEO)
+    ret = video_perceptual_hash(frame, &ans);
+  else
+    audio_perceptual_hash(frame, &layout, &ans);
+  caml_acquire_runtime_system();
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(caml_copy_int64((int64_t)ans));
+}
+
+/***** Audio FIFO *****/
+
+typedef struct {
+  AVAudioFifo *fifo;
+  enum AVSampleFormat sample_fmt;
+  AVChannelLayout ch_layout;
+  int sample_rate;
+  AVRational time_base;
+  /* The head sample is [pts_offset] samples after the one which had [pts],
+     in [time_base], or [pts] is AV_NOPTS_VALUE. Kept apart so that reading
+     many frames does not accumulate rounding errors. */
+  int64_t pts;
+  int64_t pts_offset;
+  // Buffers of read frames: frame_size ones, and the last partial one.
+  frame_pool_t *pool;
+} audio_fifo_t;
+
+#define Audio_fifo_val(v) (*(audio_fifo_t **)Data_custom_val(v))
+
+static void finalize_audio_fifo(value v) {
+  audio_fifo_t *fifo = Audio_fifo_val(v);
+
+  av_audio_fifo_free(fifo->fifo);
+  frame_pool_free(fifo->pool);
+  av_channel_layout_uninit(&fifo->ch_layout);
+  av_free(fifo);
+}
+
+static struct custom_operations audio_fifo_ops = {
+    "ocaml_avaudiofifo",        finalize_audio_fifo,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+CAMLprim value ocaml_avutil_audio_fifo_create(value _sample_fmt,
+                                              value _channel_layout,
+                                              value _sample_rate,
+                                              value _time_base, value _size) {
+  CAMLparam5(_sample_fmt, _channel_layout, _sample_rate, _time_base, _size);
+  CAMLlocal1(ans);
+  enum AVSampleFormat sample_fmt = SampleFormat_val(_sample_fmt);
+  audio_fifo_t *fifo;
+  int ret;
+
+  fifo = av_mallocz(sizeof(audio_fifo_t));
+  if (!fifo)
+    caml_raise_out_of_memory();
+
+  fifo->sample_fmt = sample_fmt;
+  fifo->sample_rate = Int_val(_sample_rate);
+  fifo->time_base = rational_of_value(_time_base);
+  fifo->pts = AV_NOPTS_VALUE;
+
+  ret = av_channel_layout_copy(&fifo->ch_layout,
+                               AVChannelLayout_val(_channel_layout));
+  if (ret < 0) {
+    av_free(fifo);
+    ocaml_avutil_raise_error(ret);
+  }
+
+  fifo->fifo = av_audio_fifo_alloc(sample_fmt, fifo->ch_layout.nb_channels,
+                                   Int_val(_size));
+  fifo->pool = frame_pool_alloc(2);
+  if (!fifo->fifo || !fifo->pool) {
+    av_audio_fifo_free(fifo->fifo);
+    frame_pool_free(fifo->pool);
+    av_channel_layout_uninit(&fifo->ch_layout);
+    av_free(fifo);
+    caml_raise_out_of_memory();
+  }
+
+  ans = caml_alloc_custom(&audio_fifo_ops, sizeof(audio_fifo_t *), 0, 1);
+  Audio_fifo_val(ans) = fifo;
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_audio_fifo_size(value _fifo) {
+  CAMLparam1(_fifo);
+  CAMLreturn(Val_int(av_audio_fifo_size(Audio_fifo_val(_fifo)->fifo)));
+}
+
+CAMLprim value ocaml_avutil_audio_fifo_reset(value _fifo) {
+  CAMLparam1(_fifo);
+  audio_fifo_t *fifo = Audio_fifo_val(_fifo);
+
+  av_audio_fifo_reset(fifo->fifo);
+  fifo->pts = AV_NOPTS_VALUE;
+  fifo->pts_offset = 0;
+
+  CAMLreturn(Val_unit);
+}
+
+static int audio_fifo_write(audio_fifo_t *fifo, void **data, int nb_samples,
+                            int64_t pts) {
+  int queued = av_audio_fifo_size(fifo->fifo);
+  int ret;
+
+  caml_release_runtime_system();
+  ret = av_audio_fifo_write(fifo->fifo, data, nb_samples);
+  caml_acquire_runtime_system();
+
+  if (ret < 0)
+    return ret;
+
+  // Follow the input's clock: its first sample is [queued] after the head.
+  if (pts != AV_NOPTS_VALUE) {
+    fifo->pts = pts;
+    fifo->pts_offset = -queued;
+  }
+
+  return 0;
+}
+
+CAMLprim value ocaml_avutil_audio_fifo_write_frame(value _fifo, value _frame) {
+  CAMLparam2(_fifo, _frame);
+  audio_fifo_t *fifo = Audio_fifo_val(_fifo);
+  AVFrame *frame = Frame_val(_frame);
+  int ret;
+
+  if (frame->format != fifo->sample_fmt ||
+      av_channel_layout_compare(&frame->ch_layout, &fifo->ch_layout) ||
+      (frame->sample_rate && frame->sample_rate != fifo->sample_rate))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  ret = audio_fifo_write(fifo, (void **)frame->extended_data,
+                         frame->nb_samples, frame->pts);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_avutil_audio_fifo_write(value _fifo, value _pts,
+                                             value _offset, value _length,
+                                             value _planes) {
+  CAMLparam5(_fifo, _pts, _offset, _length, _planes);
+  audio_fifo_t *fifo = Audio_fifo_val(_fifo);
+  int planar = av_sample_fmt_is_planar(fifo->sample_fmt);
+  int channels = fifo->ch_layout.nb_channels;
+  int planes = planar ? channels : 1;
+  int bps = av_get_bytes_per_sample(fifo->sample_fmt) * (planar ? 1 : channels);
+  int offset = Int_val(_offset);
+  int length = Int_val(_length);
+  int64_t pts = AV_NOPTS_VALUE;
+  intnat size;
+  void **data;
+  int i, ret;
+
+  if (Wosize_val(_planes) != planes || offset < 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  for (i = 0; i < planes; i++) {
+    // In samples, from [offset]: negative when [offset] is past the end.
+    size = Caml_ba_array_val(Field(_planes, i))->dim[0] / bps - offset;
+
+    if (length < 0)
+      length = size;
+
+    if (size < 0 || size < length)
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+
+  if (_pts != Val_none)
+    pts = Int64_val(Some_val(_pts));
+
+  data = av_malloc_array(planes, sizeof(void *));
+  if (!data)
+    caml_raise_out_of_memory();
+
+  for (i = 0; i < planes; i++)
+    data[i] = (uint8_t *)Caml_ba_data_val(Field(_planes, i)) + offset * bps;
+
+  // Bigarray data does not move, and [_planes] is rooted.
+  ret = audio_fifo_write(fifo, data, length, pts);
+  av_free(data);
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(Val_unit);
+}
+
+/* Output frames share pooled buffers: an encoder loop reading frame_size
+   samples at a time allocates nothing but the AVFrame itself. */
+static AVFrame *audio_fifo_alloc_frame(audio_fifo_t *fifo, int nb_samples) {
+  AVFrame *frame = av_frame_alloc();
+  int ret;
+
+  if (!frame)
+    caml_raise_out_of_memory();
+
+  frame->format = fifo->sample_fmt;
+  frame->sample_rate = fifo->sample_rate;
+  frame->nb_samples = nb_samples;
+  frame->time_base = fifo->time_base;
+
+  ret = av_channel_layout_copy(&frame->ch_layout, &fifo->ch_layout);
+  if (ret >= 0)
+    ret = frame_pool_get_audio_buffer(fifo->pool, frame);
+
+  if (ret < 0) {
+    av_frame_free(&frame);
+    ocaml_avutil_raise_error(ret);
+  }
+
+  return frame;
+}
+
+CAMLprim value ocaml_avutil_audio_fifo_read(value _fifo, value _partial,
+                                            value _nb_samples) {
+  CAMLparam3(_fifo, _partial, _nb_samples);
+  CAMLlocal2(ans, ret);
+  audio_fifo_t *fifo = Audio_fifo_val(_fifo);
+  int nb_samples = Int_val(_nb_samples);
+  int size = av_audio_fifo_size(fifo->fifo);
+  AVFrame *frame;
+  int err;
+
+  if (nb_samples <= 0)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  if (size < nb_samples) {
+    if (!Bool_val(_partial) || size == 0)
+      CAMLreturn(Val_none);
+    nb_samples = size;
+  }
+
+  frame = audio_fifo_alloc_frame(fifo, nb_samples);
+
+  if (fifo->pts != AV_NOPTS_VALUE)
+    frame->pts =
+        fifo->pts + av_rescale_q(fifo->pts_offset,
+                                 (AVRational){1, fifo->sample_rate},
+                                 fifo->time_base);
+
+  caml_release_runtime_system();
+  err = av_audio_fifo_read(fifo->fifo, (void **)frame->extended_data,
+                           nb_samples);
+  caml_acquire_runtime_system();
+
+  if (err < 0) {
+    av_frame_free(&frame);
+    ocaml_avutil_raise_error(err);
+  }
+
+  fifo->pts_offset += nb_samples;
+
+  value_of_frame(&ans, frame);
+
+  ret = caml_alloc_tuple(1);
+  Store_field(ret, 0, ans);
+
+  CAMLreturn(ret);
+}
+
+CAMLprim value ocaml_avutil_video_frame_width(value _frame) {
+  CAMLparam1(_frame);
+
+  AVFrame *frame = Frame_val(_frame);
 
   CAMLreturn(Val_int(frame->width));
 }
@@ -1258,34 +3677,135 @@ CAMLprim value ocaml_avutil_video_frame_get_linesize(value _frame,
   CAMLreturn(Val_int(frame->linesize[line]));
 }
 
+/***** Frame plane views *****/
+
+/* Plane views are bigarrays whose proxy holds a reference on the frame's
+   buffer. Sub-arrays share the proxy and these operations, so the data
+   stays valid for as long as any view of it is reachable. The runtime's
+   own bigarray comparison and serialization are not public: views can be
+   neither compared as a whole nor marshalled. */
+typedef struct {
+  struct caml_ba_proxy proxy;
+  AVBufferRef *buffer;
+} plane_proxy_t;
+
+static void finalize_plane_view(value v) {
+  plane_proxy_t *proxy = (plane_proxy_t *)Caml_ba_array_val(v)->proxy;
+
+#if OCAML_VERSION_MAJOR >= 5
+  if (atomic_fetch_sub(&proxy->proxy.refcount, 1) > 1)
+    return;
+#else
+  if (--proxy->proxy.refcount > 0)
+    return;
+#endif
+
+  av_buffer_unref(&proxy->buffer);
+  av_free(proxy);
+}
+
+static struct custom_operations plane_view_ops = {
+    "ocaml_avutil_plane_view",  finalize_plane_view,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+/* [len] elements of [kind] at [data], in plane [plane] of [frame]. Clamped
+   to the plane's buffer. */
+static value plane_view(value *ret, AVFrame *frame, int plane, int kind,
+                        uint8_t *data, intnat len) {
+  AVBufferRef *buffer = av_frame_get_plane_buffer(frame, plane);
+  struct caml_ba_array *ba;
+  plane_proxy_t *proxy;
+  intnat elt_size = caml_ba_element_size[kind];
+
+  if (!buffer || data < buffer->data || data > buffer->data + buffer->size)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  if (len > (buffer->data + buffer->size - data) / elt_size)
+    len = (buffer->data + buffer->size - data) / elt_size;
+
+  // External until the proxy is in place, so that nothing is freed on error.
+  *ret = caml_ba_alloc(CAML_BA_C_LAYOUT | CAML_BA_EXTERNAL | kind, 1, data,
+                       &len);
+
+  proxy = av_mallocz(sizeof(plane_proxy_t));
+  if (!proxy)
+    caml_raise_out_of_memory();
+
+  proxy->buffer = av_buffer_ref(buffer);
+  if (!proxy->buffer) {
+    av_free(proxy);
+    caml_raise_out_of_memory();
+  }
+
+  proxy->proxy.refcount = 1;
+  proxy->proxy.data = data;
+  proxy->proxy.size = len * elt_size;
+
+  ba = Caml_ba_array_val(*ret);
+  ba->proxy = &proxy->proxy;
+  ba->flags = (ba->flags & ~CAML_BA_MANAGED_MASK) | CAML_BA_MAPPED_FILE;
+  Custom_ops_val(*ret) = &plane_view_ops;
+
+  return *ret;
+}
+
+/* Shared memory frames are shared on purpose: they are written in place
+   rather than copied away from their other mappings. */
+int ocaml_avutil_frame_make_writable(AVFrame *frame) {
+  if (is_shm_buffer(frame->buf[0]))
+    return 0;
+
+  return av_frame_make_writable(frame);
+}
+
+static void frame_make_writable(AVFrame *frame, value _make_writable) {
+  int ret;
+
+  if (!Bool_val(_make_writable))
+    return;
+
+  ret = ocaml_avutil_frame_make_writable(frame);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+}
+
 CAMLprim value ocaml_avutil_video_get_frame_bigarray_planes(
     value _frame, value _make_writable) {
-  CAMLparam1(_frame);
-  CAMLlocal2(ans, plane);
+  CAMLparam2(_frame, _make_writable);
+  CAMLlocal3(ans, plane, data);
   AVFrame *frame = Frame_val(_frame);
-  int i;
-
-  if (Bool_val(_make_writable)) {
-    int ret = av_frame_make_writable(frame);
+  ptrdiff_t linesizes[4];
+  size_t sizes[4];
+  int i, ret;
 
-    if (ret < 0)
-      ocaml_avutil_raise_error(ret);
-  }
+  frame_make_writable(frame, _make_writable);
 
   int nb_planes = av_pix_fmt_count_planes((enum AVPixelFormat)frame->format);
 
   if (nb_planes < 0)
     ocaml_avutil_raise_error(nb_planes);
 
+  for (i = 0; i < 4; i++) {
+    if (frame->linesize[i] < 0)
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+    linesizes[i] = frame->linesize[i];
+  }
+
+  // Chroma planes are shorter than the frame.
+  ret = av_image_fill_plane_sizes(sizes, frame->format, frame->height,
+                                  linesizes);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
   ans = caml_alloc_tuple(nb_planes);
 
   for (i = 0; i < nb_planes; i++) {
-    intnat out_size = frame->linesize[i] * frame->height;
-    plane = caml_alloc_tuple(2);
+    plane_view(&data, frame, i, CAML_BA_UINT8, frame->data[i], sizes[i]);
 
-    Store_field(plane, 0,
-                caml_ba_alloc(CAML_BA_C_LAYOUT | CAML_BA_UINT8, 1,
-                              frame->data[i], &out_size));
+    plane = caml_alloc_tuple(2);
+    Store_field(plane, 0, data);
     Store_field(plane, 1, Val_int(frame->linesize[i]));
     Store_field(ans, i, plane);
   }
@@ -1293,6 +3813,54 @@ CAMLprim value ocaml_avutil_video_get_frame_bigarray_planes(
   CAMLreturn(ans);
 }
 
+CAMLprim value ocaml_avutil_video_get_frame_bigarray_palette(
+    value _frame, value _make_writable) {
+  CAMLparam2(_frame, _make_writable);
+  CAMLlocal1(ans);
+  AVFrame *frame = Frame_val(_frame);
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+
+  if (!desc || !(desc->flags & AV_PIX_FMT_FLAG_PAL))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  frame_make_writable(frame, _make_writable);
+
+  if (!frame->data[1])
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  plane_view(&ans, frame, 1, CAML_BA_UINT8, frame->data[1], AVPALETTE_SIZE);
+
+  CAMLreturn(ans);
+}
+
+CAMLprim value ocaml_avutil_audio_get_frame_bigarray_planes(
+    value _frame, value _make_writable, value _kind) {
+  CAMLparam3(_frame, _make_writable, _kind);
+  CAMLlocal2(ans, data);
+  AVFrame *frame = Frame_val(_frame);
+  int kind = Int_val(_kind);
+  int planar = av_sample_fmt_is_planar(frame->format);
+  int channels = frame->ch_layout.nb_channels;
+  int nb_planes = planar ? channels : 1;
+  intnat len = frame->nb_samples * (planar ? 1 : channels);
+  int i;
+
+  // The bigarray kind is the witness of the OCaml element type.
+  if (bigarray_kind_of_AVSampleFormat(frame->format) != kind)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  frame_make_writable(frame, _make_writable);
+
+  ans = caml_alloc_tuple(nb_planes);
+
+  for (i = 0; i < nb_planes; i++) {
+    plane_view(&data, frame, i, kind, frame->extended_data[i], len);
+    Store_field(ans, i, data);
+  }
+
+  CAMLreturn(ans);
+}
+
 /***** AVSubtitle *****/
 
 void static finalize_subtitle(value v) {
@@ -1,6 +1,7 @@
 #ifndef _AVUTIL_STUBS_H_
 #define _AVUTIL_STUBS_H_
 
+#include <stdatomic.h>
 #include <stdio.h>
 
 #include <caml/mlvalues.h>
@@ -54,6 +55,26 @@ void ocaml_avutil_dict_of_options(value _opts, AVDictionary **options);
    intervening allocation. */
 value ocaml_avutil_unused_options(AVDictionary **options);
 
+/***** Generated enum tables *****/
+
+struct ocaml_avutil_enum_index;
+
+/* One gen_code table: [tab] pairs OCaml and C values in header order,
+   [by_ml] lists its indices sorted by OCaml value. [c_index] is built on
+   first C to OCaml lookup: a dense array when the C values are compact,
+   a sorted one otherwise. */
+typedef struct {
+  const int64_t (*tab)[2];
+  int len;
+  const int *by_ml;
+  _Atomic(struct ocaml_avutil_enum_index *) c_index;
+} ocaml_avutil_enum_t;
+
+/* Both return an index into [tab], or -1 when there is no such entry. When
+   several entries share a C value, the first one in [tab] wins. */
+int ocaml_avutil_enum_find_ml(const ocaml_avutil_enum_t *e, value v);
+int ocaml_avutil_enum_find_c(ocaml_avutil_enum_t *e, int64_t c);
+
 #define List_init(list) (list) = Val_emptylist
 
 #define List_add(list, cons, val)                                              \
@@ -146,6 +167,10 @@ value Val_HwDeviceType(enum AVHWDeviceType t);
 
 void value_of_frame(value *ret, AVFrame *frame);
 
+/* av_frame_make_writable, except that shared memory frames are never
+   copied. */
+int ocaml_avutil_frame_make_writable(AVFrame *frame);
+
 /***** AVSubtitle *****/
 #define Subtitle_val(v) (*(struct AVSubtitle **)Data_custom_val(v))
 
@@ -0,0 +1,74 @@
+(* Times the generated enum conversions on the first and last pixel formats
+   of the table, against a linear scan of the same table as the conversions
+   used to do. Lookups are indexed, so both ends should cost the same while
+   the scan grows with the position in the table. *)
+
+open Avutil
+
+let iterations = 10_000_000
+
+let time name fn =
+  let start = Sys.time () in
+  for _ = 1 to iterations do
+    ignore (Sys.opaque_identity (fn ()))
+  done;
+  let elapsed = Sys.time () -. start in
+  Printf.printf "%-48s %6.2f ns/call\n%!" name
+    (elapsed *. 1e9 /. float iterations);
+  elapsed
+
+(* The table as the generated code sees it: (OCaml value, C value) pairs, in
+   table order. *)
+let table =
+  Array.of_list
+    (List.filter_map
+       (fun id ->
+         try Some (Pixel_format.find_id id, id) with _ -> None)
+       (List.init 1024 (fun id -> id)))
+
+(* The former [Val_PixelFormat] and [PixelFormat_val]: scan until found. This
+   runs without the stub call the C scan paid for, which favours it. *)
+let scan_find_id id =
+  let rec scan i =
+    if i = Array.length table then raise Not_found
+    else if snd table.(i) = id then fst table.(i)
+    else scan (i + 1)
+  in
+  scan 0
+
+let scan_get_id format =
+  let rec scan i =
+    if i = Array.length table then raise Not_found
+    else if fst table.(i) == format then snd table.(i)
+    else scan (i + 1)
+  in
+  scan 0
+
+let () =
+  Printf.printf "%d pixel formats\n%!" (Array.length table);
+  List.iter
+    (fun (format, id) ->
+      let name = Option.value ~default:"?" (Pixel_format.to_string format) in
+      let indexed =
+        time
+          (Printf.sprintf "Pixel_format.find_id %s" name)
+          (fun () -> Pixel_format.find_id id)
+      in
+      let scanned =
+        time
+          (Printf.sprintf "linear scan find_id %s" name)
+          (fun () -> scan_find_id id)
+      in
+      Printf.printf "%-48s %6.2fx\n%!" "  speedup" (scanned /. indexed);
+      let indexed =
+        time
+          (Printf.sprintf "Pixel_format.get_id %s" name)
+          (fun () -> Pixel_format.get_id format)
+      in
+      let scanned =
+        time
+          (Printf.sprintf "linear scan get_id %s" name)
+          (fun () -> scan_get_id format)
+      in
+      Printf.printf "%-48s %6.2fx\n%!" "  speedup" (scanned /. indexed))
+    [table.(0); table.(Array.length table - 1)]
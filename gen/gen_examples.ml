@@ -27,10 +27,12 @@ let () =
     stanza "webcam" ["ffmpeg-av"; "ffmpeg-avdevice"];
     stanza "bitmap_subtitle_to_jpeg" ["ffmpeg-av"; "ffmpeg-swscale"];
     stanza "encode_audio" ["ffmpeg-avcodec"; "ffmpeg-swresample"];
+    stanza "resample_float_array" ["ffmpeg-swresample"];
     stanza "reenc_vp9" ["ffmpeg-av"; "ffmpeg-avcodec"];
     stanza "all_codecs" ["ffmpeg-avcodec"];
     stanza "all_bitstream_filters" ["ffmpeg-avcodec"];
     stanza "all_channel_layouts" ["ffmpeg-avutil"];
+    stanza "enum_conversions" ["ffmpeg-avutil"];
     stanza "list_filters" ["ffmpeg-avfilter"];
     stanza "filter_info" ["ffmpeg-avfilter"];
     stanza "audio_device" ["ffmpeg-avdevice"]
@@ -18,8 +18,28 @@ let () =
         "test_options";
         "test_swscale";
         "test_swresample";
+        "test_audio_fifo";
+        "test_frame_planes";
+        "test_frame_pool";
+        "test_audio_dsp";
+        "test_shm_frame";
+        "test_bigarray_frame";
+        "test_fingerprint";
+        "test_filter_drain";
+        "test_filter_push";
+        "test_filter_profile";
+        "test_filter_threads";
+        "test_filter_reconfigure";
+        "test_filter_broadcast";
+        "test_capture";
       ]
-      ["ffmpeg-av"; "ffmpeg-swresample"; "ffmpeg-swscale"];
+      [
+        "ffmpeg-av";
+        "ffmpeg-avdevice";
+        "ffmpeg-avfilter";
+        "ffmpeg-swresample";
+        "ffmpeg-swscale";
+      ];
     print_string
       {|
 (rule
@@ -31,6 +51,20 @@ let () =
   (:options test_options.exe)
   (:swscale test_swscale.exe)
   (:swresample test_swresample.exe)
+  (:audio_fifo test_audio_fifo.exe)
+  (:frame_planes test_frame_planes.exe)
+  (:frame_pool test_frame_pool.exe)
+  (:audio_dsp test_audio_dsp.exe)
+  (:shm_frame test_shm_frame.exe)
+  (:bigarray_frame test_bigarray_frame.exe)
+  (:fingerprint test_fingerprint.exe)
+  (:filter_drain test_filter_drain.exe)
+  (:filter_push test_filter_push.exe)
+  (:filter_profile test_filter_profile.exe)
+  (:filter_threads test_filter_threads.exe)
+  (:filter_reconfigure test_filter_reconfigure.exe)
+  (:filter_broadcast test_filter_broadcast.exe)
+  (:capture test_capture.exe)
   (:list_filters ../examples/list_filters.exe)
   (:all_codecs ../examples/all_codecs.exe)
   (:all_channel_layouts ../examples/all_channel_layouts.exe)
@@ -63,6 +97,20 @@ let () =
    (run %{runner} "codec" %{codec})
    (run %{runner} "swscale" %{swscale})
    (run %{runner} "swresample" %{swresample})
+   (run %{runner} "audio_fifo" %{audio_fifo})
+   (run %{runner} "frame_planes" %{frame_planes})
+   (run %{runner} "frame_pool" %{frame_pool})
+   (run %{runner} "audio_dsp" %{audio_dsp})
+   (run %{runner} "shm_frame" %{shm_frame})
+   (run %{runner} "bigarray_frame" %{bigarray_frame})
+   (run %{runner} "fingerprint" %{fingerprint})
+   (run %{runner} "filter_drain" %{filter_drain})
+   (run %{runner} "filter_push" %{filter_push})
+   (run %{runner} "filter_profile" %{filter_profile})
+   (run %{runner} "filter_threads" %{filter_threads})
+   (run %{runner} "filter_reconfigure" %{filter_reconfigure})
+   (run %{runner} "filter_broadcast" %{filter_broadcast})
+   (run %{runner} "capture" %{capture})
    (run %{runner} "list_filters" %{list_filters})
    (run %{runner} "all_codecs" %{all_codecs})
    (run %{runner} "all_channel_layouts" %{all_channel_layouts})
@@ -145,18 +145,48 @@ let translate_enum_lines ?h_oc ?ml_oc lines labels =
 
     print_c ["};\n\n#define "; tab_len; " "; string_of_int (List.length values)];
 
+    (* Entry indices sorted by OCaml value, for bisection in [Xxx_val]. The C
+       values are only known to the compiler so the reverse index is built at
+       runtime, see [ocaml_avutil_enum_find_c]. *)
+    let by_ml = tab_name ^ "_BY_ML" in
+    let sorted =
+      List.sort
+        (fun (v, _) (v', _) -> Int64.compare v v')
+        (List.mapi (fun i v -> (v, i)) (List.rev values))
+    in
+    print_c
+      [
+        "\nstatic const int ";
+        by_ml;
+        "[] = {";
+        String.concat ", " (List.map (fun (_, i) -> string_of_int i) sorted);
+        "};\n";
+      ];
+
+    let enum_name = tab_name ^ "_ENUM" in
+    print_c
+      [
+        "static ocaml_avutil_enum_t ";
+        enum_name;
+        " = {";
+        tab_name;
+        ", ";
+        tab_len;
+        ", ";
+        by_ml;
+        ", NULL};\n";
+      ];
+
     print_c
       [
         c_type_name;
         " ";
         c_fun_radix;
-        "_val(value v){\nint i;\nfor(i=0;i<";
-        tab_len;
-        ";i++){\nif(v==";
-        tab_name;
-        "[i][0])return ";
+        "_val(value v){\nint i = ocaml_avutil_enum_find_ml(&";
+        enum_name;
+        ", v);\nif(i>=0)return ";
         tab_name;
-        "[i][1];\n}\nFail(\"Could not find C value for %\" PRIu64 \" in "
+        "[i][1];\nFail(\"Could not find C value for %\" PRIu64 \" in "
         ^ tab_name
         ^ ". Do you need to recompile the ffmpeg binding?\", (uint64_t)v);\n\
            return -1;\n\
@@ -168,13 +198,11 @@ let translate_enum_lines ?h_oc ?ml_oc lines labels =
         c_type_name;
         " ";
         c_fun_radix;
-        "_val_no_raise(value v){\nint i;\nfor(i=0;i<";
-        tab_len;
-        ";i++){\nif(v==";
-        tab_name;
-        "[i][0])return ";
+        "_val_no_raise(value v){\nint i = ocaml_avutil_enum_find_ml(&";
+        enum_name;
+        ", v);\nif(i>=0)return ";
         tab_name;
-        "[i][1];\n}\nreturn VALUE_NOT_FOUND;\n}";
+        "[i][1];\nreturn VALUE_NOT_FOUND;\n}";
       ];
 
     print_c
@@ -183,14 +211,12 @@ let translate_enum_lines ?h_oc ?ml_oc lines labels =
         c_fun_radix;
         "(";
         c_type_name;
-        " t){\nint i;\nfor(i=0;i<";
-        tab_len;
         (* The table is int64_t; c_type_name may be unsigned. *)
-        "; i++){\nif((int64_t)t==";
-        tab_name;
-        "[i][1])return ";
+        " t){\nint i = ocaml_avutil_enum_find_c(&";
+        enum_name;
+        ", (int64_t)t);\nif(i>=0)return ";
         tab_name;
-        "[i][0];\n}\nFail(\"Could not find OCaml value for %\" PRIu64 \" in "
+        "[i][0];\nFail(\"Could not find OCaml value for %\" PRIu64 \" in "
         ^ tab_name
         ^ ". Do you need to recompile the ffmpeg binding?\", (uint64_t)t);\n\
            return -1;\n\
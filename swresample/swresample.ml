@@ -333,5 +333,23 @@ module Make (I : AudioData) (O : AudioData) = struct
   external convert : ?offset:int -> ?length:int -> t -> I.t -> O.t
     = "ocaml_swresample_convert"
 
+  external convert_into : ?offset:int -> ?length:int -> t -> I.t -> O.t -> int
+    = "ocaml_swresample_convert_into_byte" "ocaml_swresample_convert_into"
+
+  external get_out_samples : t -> int -> int
+    = "ocaml_swresample_get_out_samples"
+
   external flush : t -> O.t = "ocaml_swresample_flush"
+
+  external set_compensation : t -> int -> int -> unit
+    = "ocaml_swresample_set_compensation"
+
+  let set_compensation ctx ~delta ~distance =
+    set_compensation ctx delta distance
+
+  external convert_all : (t * I.t) array -> O.t array
+    = "ocaml_swresample_convert_all"
+
+  external next_pts : t -> Int64.t -> Int64.t = "ocaml_swresample_next_pts"
+  external get_delay : t -> int -> Int64.t = "ocaml_swresample_get_delay"
 end
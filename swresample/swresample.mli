@@ -85,8 +85,55 @@ module Make (I : AudioData) (O : AudioData) : sig
       Raise Error if the conversion failed. *)
   val convert : ?offset:int -> ?length:int -> t -> I.t -> O.t
 
+  (** [Swresample.convert_into rsp iad oad] does the same as [convert],
+      writing into [oad] instead of allocating a new output, e.g. to reuse it
+      from one chunk to the next. Returns the number of samples per channel
+      written at the start of [oad]. Samples which do not fit are kept for the
+      next call. A frame output must have the context's output format and
+      channels, is made writable first and gets the number of samples
+      written. Making it writable copies it when other references to its
+      data are alive, such as views from [Avutil.Audio.frame_planes]: these
+      then do not see the output.
+
+      Raise Error if [oad] does not match the output format or if the
+      conversion failed. *)
+  val convert_into : ?offset:int -> ?length:int -> t -> I.t -> O.t -> int
+
+  (** [Swresample.convert_all [|(rsp, iad); ...|]] does the same as
+      [convert] on each pair, the conversions running concurrently on a pool
+      of native threads, one per core, without the OCaml runtime lock. Outputs
+      are returned in the order of the pairs.
+
+      Raise Error if a context appears twice or if a conversion failed. *)
+  val convert_all : (t * I.t) array -> O.t array
+
+  (** [Swresample.get_out_samples rsp n] is an upper bound on the number of
+      samples per channel that converting [n] more input samples produces, to
+      size outputs for {!convert_into}. *)
+  val get_out_samples : t -> int -> int
+
   (** [Swresample.convert rpsp] flushes the last remaining data. *)
   val flush : t -> O.t
+
+  (** [Swresample.set_compensation rsp ~delta ~distance] stretches or
+      squeezes the output by [delta] samples spread over the next [distance]
+      output samples, e.g. to follow the drift between two clocks without
+      dropping or inserting chunks.
+
+      Raise Error if the compensation cannot be set. *)
+  val set_compensation : t -> delta:int -> distance:int -> unit
+
+  (** [Swresample.next_pts rsp pts] returns the output timestamp of the next
+      output sample, given the timestamp [pts] of the next input sample, both
+      in units of 1 / (in_sample_rate * out_sample_rate). Passing
+      [Int64.min_int] for an input without timestamp, it is extrapolated from
+      the previous ones. *)
+  val next_pts : t -> Int64.t -> Int64.t
+
+  (** [Swresample.get_delay rsp base] returns the delay of the next input
+      sample through the context, in units of [1 / base]: [base] can be the
+      input or output sample rate, for a delay in samples. *)
+  val get_delay : t -> int -> Int64.t
 end
 
 (** Byte string with undefined sample format for interleaved channels. The
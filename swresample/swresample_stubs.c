@@ -14,10 +14,15 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <libavformat/avformat.h>
+#include <libavutil/cpu.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libavutil/samplefmt.h>
@@ -34,6 +39,52 @@ static inline double filter_nan(double s) {
   return s;
 }
 
+/* Copies [len] doubles, NaNs replaced by 0, between OCaml float arrays and
+   sample buffers. OCaml only guarantees word alignment to float arrays,
+   hence the unaligned loads and stores. Comparing a vector to itself masks
+   out its NaNs without branching. The vector extensions are sized for SSE2
+   and NEON, wider targets being left to the compiler. */
+
+#ifdef __GNUC__
+#define FA_VECTOR
+typedef double fa_vec_t __attribute__((vector_size(16)));
+typedef int64_t fa_mask_t __attribute__((vector_size(16)));
+#define FA_VEC_LEN 2
+#endif
+
+/* Cleared by examples/resample_float_array.ml to time the scalar loop. */
+static int fa_vector = 1;
+
+CAMLprim value ocaml_swresample_set_vector_copies(value _vector) {
+  fa_vector = Bool_val(_vector);
+  return Val_unit;
+}
+
+static void filter_nan_copy(void *dst, const void *src, int len) {
+  uint8_t *d = dst;
+  const uint8_t *s = src;
+  double v;
+  int i = 0;
+
+#ifdef FA_VECTOR
+  fa_vec_t vec;
+
+  for (; fa_vector && i + FA_VEC_LEN <= len; i += FA_VEC_LEN) {
+    memcpy(&vec, s + i * sizeof(double), sizeof(fa_vec_t));
+    vec = (fa_vec_t)((fa_mask_t)vec & (vec == vec));
+    memcpy(d + i * sizeof(double), &vec, sizeof(fa_vec_t));
+  }
+#endif
+
+  for (; i < len; i++) {
+    memcpy(&v, s + i * sizeof(double), sizeof(double));
+    v = filter_nan(v);
+    memcpy(d + i * sizeof(double), &v, sizeof(double));
+  }
+}
+
+#define Float_array_data(v) ((double *)Op_val(v))
+
 /***** Contexts *****/
 struct audio_t {
   uint8_t **data;
@@ -157,7 +208,7 @@ static int get_in_samples_planar_string(swr_t *swr, value *in_vector,
 
 static int get_in_samples_float_array(swr_t *swr, value *in_vector,
                                       int offset) {
-  int i, linesize = Wosize_val(*in_vector) / Double_wosize;
+  int linesize = Wosize_val(*in_vector) / Double_wosize;
   int nb_samples = linesize / swr->in.nb_channels - offset;
 
   if (nb_samples < 0)
@@ -166,11 +217,9 @@ static int get_in_samples_float_array(swr_t *swr, value *in_vector,
   if (nb_samples > swr->in.nb_samples)
     alloc_data(&swr->in, nb_samples);
 
-  double *pcm = (double *)swr->in.data[0];
-
-  for (i = 0; i < linesize; i++) {
-    pcm[i] = filter_nan(Double_field(*in_vector, i + offset));
-  }
+  filter_nan_copy(swr->in.data[0],
+                  Float_array_data(*in_vector) + offset * swr->in.nb_channels,
+                  nb_samples * swr->in.nb_channels);
 
   return nb_samples;
 }
@@ -179,7 +228,7 @@ static int get_in_samples_planar_float_array(swr_t *swr, value *in_vector,
                                              int offset) {
   CAMLparam0();
   CAMLlocal1(fa);
-  int i, j, nb_words = Wosize_val(Field(*in_vector, 0));
+  int i, nb_words = Wosize_val(Field(*in_vector, 0));
   int nb_samples = nb_words / Double_wosize - offset;
 
   if (nb_samples < 0)
@@ -197,11 +246,8 @@ static int get_in_samples_planar_float_array(swr_t *swr, value *in_vector,
            "were expected",
            i, Wosize_val(fa), nb_words);
 
-    double *pcm = (double *)swr->in.data[i];
-
-    for (j = 0; j < nb_samples; j++) {
-      pcm[j] = filter_nan(Double_field(fa, j + offset));
-    }
+    filter_nan_copy(swr->in.data[i], Float_array_data(fa) + offset,
+                    nb_samples);
   }
   CAMLreturnT(int, nb_samples);
 }
@@ -345,20 +391,14 @@ static void store_out_planar_string(swr_t *swr, int ret, value *out_vect) {
 
 static void store_out_float_array(swr_t *swr, int ret, value *out_vect) {
   int len = ret * swr->out.nb_channels;
-  int i;
-  double *pcm;
 
   *out_vect = caml_alloc(len * Double_wosize, Double_array_tag);
 
-  pcm = (double *)swr->out.data[0];
-
-  for (i = 0; i < len; i++)
-    Store_double_field(*out_vect, i, filter_nan(pcm[i]));
+  filter_nan_copy(Float_array_data(*out_vect), swr->out.data[0], len);
 }
 
 static void store_out_planar_float_array(swr_t *swr, int ret, value *out_vect) {
-  int i, j;
-  double *pcm;
+  int i;
 
   *out_vect = caml_alloc_tuple(swr->out.nb_channels);
 
@@ -366,12 +406,9 @@ static void store_out_planar_float_array(swr_t *swr, int ret, value *out_vect) {
     Store_field(*out_vect, i,
                 caml_alloc(ret * Double_wosize, Double_array_tag));
 
-  for (i = 0; i < swr->out.nb_channels; i++) {
-    pcm = (double *)swr->out.data[i];
-
-    for (j = 0; j < ret; j++)
-      Store_double_field(Field(*out_vect, i), j, filter_nan(pcm[j]));
-  }
+  for (i = 0; i < swr->out.nb_channels; i++)
+    filter_nan_copy(Float_array_data(Field(*out_vect, i)), swr->out.data[i],
+                    ret);
 }
 
 static void store_out_ba(swr_t *swr, int ret, value *out_vect) {
@@ -385,21 +422,174 @@ static void store_out_planar_ba(swr_t *swr, int ret, value *out_vect) {
     Caml_ba_array_val(Field(*out_vect, i))->dim[0] = ret;
 }
 
+/* Caller-provided outputs: get_out points the output planes at the vector,
+   or at the scratch buffer for vectors on the OCaml heap, and returns its
+   capacity in samples per channel. copy_out then moves the converted
+   samples into the vector. */
+
+static void check_out_planes(swr_t *swr, value *out_vect) {
+  if ((int)Wosize_val(*out_vect) != swr->out.nb_channels)
+    Fail("Swresample failed to convert into %lu channels : %d channels were "
+         "expected",
+         Wosize_val(*out_vect), swr->out.nb_channels);
+}
+
+static int get_out_string(swr_t *swr, value *out_vect) {
+  int nb_samples = caml_string_length(*out_vect) /
+                   (swr->out.bytes_per_samples * swr->out.nb_channels);
+
+  alloc_out_data(swr, nb_samples, out_vect);
+
+  return nb_samples;
+}
+
+static int get_out_planar_string(swr_t *swr, value *out_vect) {
+  int i, len, nb_samples = INT_MAX;
+
+  check_out_planes(swr, out_vect);
+
+  for (i = 0; i < swr->out.nb_channels; i++) {
+    len = caml_string_length(Field(*out_vect, i)) / swr->out.bytes_per_samples;
+    if (len < nb_samples)
+      nb_samples = len;
+  }
+
+  alloc_out_data(swr, nb_samples, out_vect);
+
+  return nb_samples;
+}
+
+static int get_out_float_array(swr_t *swr, value *out_vect) {
+  int nb_samples =
+      Wosize_val(*out_vect) / Double_wosize / swr->out.nb_channels;
+
+  alloc_out_data(swr, nb_samples, out_vect);
+
+  return nb_samples;
+}
+
+static int get_out_planar_float_array(swr_t *swr, value *out_vect) {
+  int i, len, nb_samples = INT_MAX;
+
+  check_out_planes(swr, out_vect);
+
+  for (i = 0; i < swr->out.nb_channels; i++) {
+    len = Wosize_val(Field(*out_vect, i)) / Double_wosize;
+    if (len < nb_samples)
+      nb_samples = len;
+  }
+
+  alloc_out_data(swr, nb_samples, out_vect);
+
+  return nb_samples;
+}
+
+static int get_out_ba(swr_t *swr, value *out_vect) {
+  swr->out.data[0] = Caml_ba_data_val(*out_vect);
+
+  return Caml_ba_array_val(*out_vect)->dim[0] / swr->out.nb_channels;
+}
+
+static int get_out_planar_ba(swr_t *swr, value *out_vect) {
+  int i, nb_samples = INT_MAX;
+  value ba;
+
+  check_out_planes(swr, out_vect);
+
+  for (i = 0; i < swr->out.nb_channels; i++) {
+    ba = Field(*out_vect, i);
+    swr->out.data[i] = Caml_ba_data_val(ba);
+
+    if (Caml_ba_array_val(ba)->dim[0] < nb_samples)
+      nb_samples = Caml_ba_array_val(ba)->dim[0];
+  }
+
+  return nb_samples;
+}
+
+static int get_out_frame(swr_t *swr, value *out_vect) {
+  AVFrame *frame = Frame_val(*out_vect);
+  int ret, planes;
+
+  if (frame->ch_layout.nb_channels != swr->out.nb_channels)
+    Fail("Swresample failed to convert into %d channels : %d channels were "
+         "expected",
+         frame->ch_layout.nb_channels, swr->out.nb_channels);
+
+  if (frame->format != swr->out.sample_fmt)
+    Fail("Swresample failed to convert into %s sample format : %s sample "
+         "format were expected",
+         av_get_sample_fmt_name(frame->format),
+         av_get_sample_fmt_name(swr->out.sample_fmt));
+
+  ret = ocaml_avutil_frame_make_writable(frame);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  swr->out.data = frame->extended_data;
+
+  /* nb_samples is only what the last conversion wrote: the capacity is
+     what the buffers hold. */
+  planes = av_sample_fmt_is_planar(frame->format) ? 1 : swr->out.nb_channels;
+
+  return frame->linesize[0] / (swr->out.bytes_per_samples * planes);
+}
+
+static void copy_out_string(swr_t *swr, int ret, value *out_vect) {
+  memcpy(Bytes_val(*out_vect), swr->out.data[0],
+         ret * swr->out.nb_channels * swr->out.bytes_per_samples);
+}
+
+static void copy_out_planar_string(swr_t *swr, int ret, value *out_vect) {
+  int i;
+
+  for (i = 0; i < swr->out.nb_channels; i++)
+    memcpy(Bytes_val(Field(*out_vect, i)), swr->out.data[i],
+           ret * swr->out.bytes_per_samples);
+}
+
+static void copy_out_float_array(swr_t *swr, int ret, value *out_vect) {
+  filter_nan_copy(Float_array_data(*out_vect), swr->out.data[0],
+                  ret * swr->out.nb_channels);
+}
+
+static void copy_out_planar_float_array(swr_t *swr, int ret, value *out_vect) {
+  int i;
+
+  for (i = 0; i < swr->out.nb_channels; i++)
+    filter_nan_copy(Float_array_data(Field(*out_vect, i)), swr->out.data[i],
+                    ret);
+}
+
+static void copy_out_none(swr_t *swr, int ret, value *out_vect) {
+  (void)swr;
+  (void)ret;
+  (void)out_vect;
+}
+
 static const struct {
   int (*get_in)(swr_t *, value *, int);
   void (*alloc_out)(swr_t *, int, value *);
   void (*store_out)(swr_t *, int, value *);
+  int (*get_out)(swr_t *, value *);
+  void (*copy_out)(swr_t *, int, value *);
 } VECTOR_OPS[] = {
-    [Str] = {get_in_samples_string, alloc_out_data, store_out_string},
+    [Str] = {get_in_samples_string, alloc_out_data, store_out_string,
+             get_out_string, copy_out_string},
     [P_Str] = {get_in_samples_planar_string, alloc_out_data,
-               store_out_planar_string},
-    [Fa] = {get_in_samples_float_array, alloc_out_data, store_out_float_array},
+               store_out_planar_string, get_out_planar_string,
+               copy_out_planar_string},
+    [Fa] = {get_in_samples_float_array, alloc_out_data, store_out_float_array,
+            get_out_float_array, copy_out_float_array},
     [P_Fa] = {get_in_samples_planar_float_array, alloc_out_data,
-              store_out_planar_float_array},
-    [Ba] = {get_in_samples_ba, alloc_out_ba, store_out_ba},
+              store_out_planar_float_array, get_out_planar_float_array,
+              copy_out_planar_float_array},
+    [Ba] = {get_in_samples_ba, alloc_out_ba, store_out_ba, get_out_ba,
+            copy_out_none},
     [P_Ba] = {get_in_samples_planar_ba, alloc_out_planar_ba,
-              store_out_planar_ba},
-    [Frm] = {get_in_samples_frame, alloc_out_frame, store_out_frame},
+              store_out_planar_ba, get_out_planar_ba, copy_out_none},
+    [Frm] = {get_in_samples_frame, alloc_out_frame, store_out_frame,
+             get_out_frame, store_out_frame},
 };
 
 /* A vector_kind added without a row here would leave a NULL function
@@ -424,15 +614,13 @@ static void convert(swr_t *swr, int in_nb_samples, int out_nb_samples,
   VECTOR_OPS[swr->out_kind].store_out(swr, ret, out_vect);
 }
 
-CAMLprim value ocaml_swresample_convert(value _ofs, value _len, value _swr,
-                                        value _in_vector) {
-  CAMLparam4(_ofs, _len, _swr, _in_vector);
-  CAMLlocal1(out_vect);
-  swr_t *swr = Swr_val(_swr);
-
+/* Acquires the input samples and returns the input number of samples per
+   channel. */
+static int get_in_samples(swr_t *swr, value _ofs, value _len,
+                          value *in_vector) {
   // consistency check between the input channels and the context ones
   if (swr->in.is_planar) {
-    int in_nb_channels = Wosize_val(_in_vector);
+    int in_nb_channels = Wosize_val(*in_vector);
 
     if (in_nb_channels != swr->in.nb_channels)
       Fail("Swresample failed to convert %d channels : %d channels were "
@@ -440,16 +628,12 @@ CAMLprim value ocaml_swresample_convert(value _ofs, value _len, value _swr,
            in_nb_channels, swr->in.nb_channels);
   }
 
-  out_vect = Val_none;
-
-  // acquisition of the input samples and the input number of samples per
-  // channel
   int offset = 0;
   if (_ofs != Val_none) {
     offset = Int_val(Field(_ofs, 0));
   }
 
-  int in_nb_samples = VECTOR_OPS[swr->in_kind].get_in(swr, &_in_vector, offset);
+  int in_nb_samples = VECTOR_OPS[swr->in_kind].get_in(swr, in_vector, offset);
   if (in_nb_samples < 0)
     ocaml_avutil_raise_error(in_nb_samples);
 
@@ -461,6 +645,48 @@ CAMLprim value ocaml_swresample_convert(value _ofs, value _len, value _swr,
     in_nb_samples = asked_nb_samples;
   }
 
+  return in_nb_samples;
+}
+
+CAMLprim value ocaml_swresample_convert_into(value _ofs, value _len,
+                                             value _swr, value _in_vector,
+                                             value _out_vect) {
+  CAMLparam5(_ofs, _len, _swr, _in_vector, _out_vect);
+  swr_t *swr = Swr_val(_swr);
+  int in_nb_samples, out_nb_samples, ret;
+
+  in_nb_samples = get_in_samples(swr, _ofs, _len, &_in_vector);
+  out_nb_samples = VECTOR_OPS[swr->out_kind].get_out(swr, &_out_vect);
+
+  caml_release_runtime_system();
+  ret = swr_convert(swr->context, swr->out.data, out_nb_samples,
+                    (const uint8_t **)swr->in.data, in_nb_samples);
+  caml_acquire_runtime_system();
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  VECTOR_OPS[swr->out_kind].copy_out(swr, ret, &_out_vect);
+
+  CAMLreturn(Val_int(ret));
+}
+
+CAMLprim value ocaml_swresample_convert_into_byte(value *argv, int argn) {
+  (void)argn;
+  return ocaml_swresample_convert_into(argv[0], argv[1], argv[2], argv[3],
+                                       argv[4]);
+}
+
+CAMLprim value ocaml_swresample_convert(value _ofs, value _len, value _swr,
+                                        value _in_vector) {
+  CAMLparam4(_ofs, _len, _swr, _in_vector);
+  CAMLlocal1(out_vect);
+  swr_t *swr = Swr_val(_swr);
+
+  out_vect = Val_none;
+
+  int in_nb_samples = get_in_samples(swr, _ofs, _len, &_in_vector);
+
   // Computation of the output number of samples per channel according to the
   // input ones
   int out_nb_samples = swr_get_out_samples(swr->context, in_nb_samples);
@@ -471,6 +697,47 @@ CAMLprim value ocaml_swresample_convert(value _ofs, value _len, value _swr,
   CAMLreturn(out_vect);
 }
 
+CAMLprim value ocaml_swresample_get_out_samples(value _swr, value _nb_samples) {
+  CAMLparam1(_swr);
+  int ret = swr_get_out_samples(Swr_val(_swr)->context, Int_val(_nb_samples));
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(Val_int(ret));
+}
+
+CAMLprim value ocaml_swresample_set_compensation(value _swr,
+                                                 value _sample_delta,
+                                                 value _distance) {
+  CAMLparam1(_swr);
+  swr_t *swr = Swr_val(_swr);
+  int ret;
+
+  /* May initialize a resampler, at equal rates. */
+  caml_release_runtime_system();
+  ret = swr_set_compensation(swr->context, Int_val(_sample_delta),
+                             Int_val(_distance));
+  caml_acquire_runtime_system();
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value ocaml_swresample_next_pts(value _swr, value _pts) {
+  CAMLparam2(_swr, _pts);
+  CAMLreturn(
+      caml_copy_int64(swr_next_pts(Swr_val(_swr)->context, Int64_val(_pts))));
+}
+
+CAMLprim value ocaml_swresample_get_delay(value _swr, value _base) {
+  CAMLparam1(_swr);
+  CAMLreturn(caml_copy_int64(
+      swr_get_delay(Swr_val(_swr)->context, Int_val(_base))));
+}
+
 CAMLprim value ocaml_swresample_flush(value _swr) {
   CAMLparam1(_swr);
   CAMLlocal1(out_vect);
@@ -488,6 +755,238 @@ CAMLprim value ocaml_swresample_flush(value _swr) {
   CAMLreturn(out_vect);
 }
 
+/***** Batch conversions *****/
+
+/* convert_all runs one swr_convert per context on a pool of native threads,
+   started on first use and never stopped, the calling thread taking its
+   share of the jobs. Batches are serialized. */
+
+#define MAX_WORKERS 32
+
+typedef struct {
+  swr_t *swr;
+  int in_nb_samples;
+  int ret;
+} swr_job_t;
+
+static struct {
+  pthread_mutex_t batch;
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  // Guarded by [batch]. Cleared in a child process, which has no workers.
+  int started;
+  int nb_workers;
+  unsigned int generation;
+  int participants;
+  int running;
+  swr_job_t *jobs;
+  int nb_jobs;
+  atomic_int next_job;
+} pool = {.batch = PTHREAD_MUTEX_INITIALIZER,
+          .lock = PTHREAD_MUTEX_INITIALIZER,
+          .work = PTHREAD_COND_INITIALIZER,
+          .done = PTHREAD_COND_INITIALIZER};
+
+static void run_jobs(void) {
+  swr_job_t *job;
+  int i;
+
+  while ((i = atomic_fetch_add(&pool.next_job, 1)) < pool.nb_jobs) {
+    job = &pool.jobs[i];
+    job->ret =
+        swr_convert(job->swr->context, job->swr->out.data,
+                    job->swr->out.nb_samples,
+                    (const uint8_t **)job->swr->in.data, job->in_nb_samples);
+  }
+}
+
+static void *worker(void *arg) {
+  int id = (int)(intptr_t)arg;
+  /* Not read from the pool: a worker scheduled late must not miss the first
+     batch. */
+  unsigned int seen = 0;
+
+  pthread_mutex_lock(&pool.lock);
+
+  for (;;) {
+    while (pool.generation == seen)
+      pthread_cond_wait(&pool.work, &pool.lock);
+    seen = pool.generation;
+
+    if (id >= pool.participants)
+      continue;
+
+    pthread_mutex_unlock(&pool.lock);
+    run_jobs();
+    pthread_mutex_lock(&pool.lock);
+
+    if (--pool.running == 0)
+      pthread_cond_signal(&pool.done);
+  }
+
+  return NULL;
+}
+
+/* Only the forking thread survives fork: the pool is held across it so
+   that no batch is half run, and started again in the child. */
+static void pool_prepare(void) {
+  pthread_mutex_lock(&pool.batch);
+  pthread_mutex_lock(&pool.lock);
+}
+
+static void pool_parent(void) {
+  pthread_mutex_unlock(&pool.lock);
+  pthread_mutex_unlock(&pool.batch);
+}
+
+static void pool_child(void) {
+  pthread_cond_init(&pool.work, NULL);
+  pthread_cond_init(&pool.done, NULL);
+  pool.started = 0;
+  pool.nb_workers = 0;
+  pool.generation = 0;
+  pool.participants = 0;
+  pool.running = 0;
+  pool_parent();
+}
+
+/* Called with [batch] held. */
+static void start_workers(void) {
+  static int at_fork = 0;
+  pthread_attr_t attr;
+  pthread_t thread;
+  int i, nb_workers = av_cpu_count() - 1;
+
+  if (!at_fork)
+    at_fork = !pthread_atfork(pool_prepare, pool_parent, pool_child);
+
+  if (nb_workers > MAX_WORKERS)
+    nb_workers = MAX_WORKERS;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  for (i = 0; i < nb_workers; i++) {
+    if (pthread_create(&thread, &attr, worker, (void *)(intptr_t)i) != 0)
+      break;
+  }
+
+  pthread_attr_destroy(&attr);
+  pool.nb_workers = i;
+  pool.started = 1;
+}
+
+/* Must be called without the runtime. */
+static void run_batch(swr_job_t *jobs, int nb_jobs) {
+  pthread_mutex_lock(&pool.batch);
+
+  if (!pool.started)
+    start_workers();
+
+  pthread_mutex_lock(&pool.lock);
+  pool.jobs = jobs;
+  pool.nb_jobs = nb_jobs;
+  atomic_store(&pool.next_job, 0);
+  pool.participants =
+      nb_jobs - 1 < pool.nb_workers ? nb_jobs - 1 : pool.nb_workers;
+  pool.running = pool.participants;
+  pool.generation++;
+  pthread_cond_broadcast(&pool.work);
+  pthread_mutex_unlock(&pool.lock);
+
+  run_jobs();
+
+  pthread_mutex_lock(&pool.lock);
+  while (pool.running > 0)
+    pthread_cond_wait(&pool.done, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+
+  pthread_mutex_unlock(&pool.batch);
+}
+
+#define Jobs_val(v) (*(swr_job_t **)Data_custom_val(v))
+
+static void finalize_jobs(value v) { av_free(Jobs_val(v)); }
+
+static struct custom_operations jobs_ops = {
+    "ocaml_swresample_jobs",    finalize_jobs,
+    custom_compare_default,     custom_hash_default,
+    custom_serialize_default,   custom_deserialize_default,
+    custom_compare_ext_default, custom_fixed_length_default};
+
+static int compare_jobs(const void *a, const void *b) {
+  const swr_t *x = ((const swr_job_t *)a)->swr;
+  const swr_t *y = ((const swr_job_t *)b)->swr;
+
+  return x < y ? -1 : x > y;
+}
+
+CAMLprim value ocaml_swresample_convert_all(value _pairs) {
+  CAMLparam1(_pairs);
+  CAMLlocal4(jobs_v, ans, in_vector, out_vect);
+  int i, err = 0, nb_jobs = Wosize_val(_pairs);
+  swr_job_t *jobs;
+  swr_t *swr;
+
+  jobs_v = caml_alloc_custom(&jobs_ops, sizeof(swr_job_t *), 0, 1);
+  jobs = av_calloc(nb_jobs ? nb_jobs : 1, sizeof(swr_job_t));
+  if (!jobs)
+    caml_raise_out_of_memory();
+  Jobs_val(jobs_v) = jobs;
+
+  /* A context holds the input and output of one conversion at a time. */
+  for (i = 0; i < nb_jobs; i++)
+    jobs[i].swr = Swr_val(Field(Field(_pairs, i), 0));
+
+  qsort(jobs, nb_jobs, sizeof(swr_job_t), compare_jobs);
+
+  for (i = 1; i < nb_jobs; i++)
+    if (jobs[i].swr == jobs[i - 1].swr)
+      ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  ans = caml_alloc_tuple(nb_jobs);
+  for (i = 0; i < nb_jobs; i++)
+    Store_field(ans, i, Val_unit);
+
+  for (i = 0; i < nb_jobs; i++) {
+    swr = Swr_val(Field(Field(_pairs, i), 0));
+    in_vector = Field(Field(_pairs, i), 1);
+
+    out_vect = Val_unit;
+
+    jobs[i].swr = swr;
+    jobs[i].in_nb_samples = get_in_samples(swr, Val_none, Val_none, &in_vector);
+
+    VECTOR_OPS[swr->out_kind].alloc_out(
+        swr, swr_get_out_samples(swr->context, jobs[i].in_nb_samples),
+        &out_vect);
+    Store_field(ans, i, out_vect);
+  }
+
+  caml_release_runtime_system();
+  run_batch(jobs, nb_jobs);
+  caml_acquire_runtime_system();
+
+  for (i = 0; i < nb_jobs; i++) {
+    if (jobs[i].ret < 0) {
+      if (!err)
+        err = jobs[i].ret;
+      continue;
+    }
+
+    out_vect = Field(ans, i);
+    VECTOR_OPS[jobs[i].swr->out_kind].store_out(jobs[i].swr, jobs[i].ret,
+                                                &out_vect);
+    Store_field(ans, i, out_vect);
+  }
+
+  if (err < 0)
+    ocaml_avutil_raise_error(err);
+
+  CAMLreturn(ans);
+}
+
 void swresample_free(swr_t *swr) {
   if (swr->context)
     swr_free(&swr->context);
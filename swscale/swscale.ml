@@ -60,13 +60,21 @@ module Bytes = struct
   let vk = Str
 end
 
-type ('i, 'o) ctx
+type sws
+
+type ('i, 'o) ctx = {
+  sws : sws;
+  (* Input and output of the picture being scaled by slices: the native
+     context works on their planes until the picture is done. *)
+  mutable picture : ('i * 'o) option;
+}
 
 module Make (I : VideoData) (O : VideoData) = struct
   type t = (I.t, O.t) ctx
 
   external create :
     flag array ->
+    int ->
     vector_kind ->
     int ->
     int ->
@@ -75,12 +83,16 @@ module Make (I : VideoData) (O : VideoData) = struct
     int ->
     int ->
     pixel_format ->
-    t = "ocaml_swscale_create_byte" "ocaml_swscale_create"
+    sws = "ocaml_swscale_create_byte" "ocaml_swscale_create"
 
-  let create flags in_width in_height in_pixel_format out_width out_height
-      out_pixel_format =
-    create (Array.of_list flags) I.vk in_width in_height in_pixel_format O.vk
-      out_width out_height out_pixel_format
+  let create ?(threads = 1) flags in_width in_height in_pixel_format out_width
+      out_height out_pixel_format =
+    {
+      sws =
+        create (Array.of_list flags) threads I.vk in_width in_height
+          in_pixel_format O.vk out_width out_height out_pixel_format;
+      picture = None;
+    }
 
   (*
      let from_codec flags in_codec out_width out_height out_pixel_format =
@@ -112,5 +124,117 @@ module Make (I : VideoData) (O : VideoData) = struct
          (Avcodec.Video.get_pixel_format out_codec)
   *)
 
-  external convert : t -> I.t -> O.t = "ocaml_swscale_convert"
+  external convert : sws -> I.t -> O.t = "ocaml_swscale_convert"
+
+  (* Both abandon any picture being scaled by slices. *)
+  let convert ctx input =
+    let output = convert ctx.sws input in
+    ctx.picture <- None;
+    output
+
+  external convert_into : sws -> I.t -> O.t -> unit
+    = "ocaml_swscale_convert_into"
+
+  let convert_into ctx input output =
+    convert_into ctx.sws input output;
+    ctx.picture <- None
+
+  external send_slice : sws -> I.t -> O.t -> int -> int -> int * int
+    = "ocaml_swscale_send_slice"
+
+  let send_slice ctx ~y ~h input output =
+    if y = 0 then ctx.picture <- Some (input, output);
+    send_slice ctx.sws input output y h
+
+  module Cache = struct
+    let create_context = create
+
+    type key = flag list * int * int * pixel_format * int * int * pixel_format
+
+    (* Entries form a doubly linked list, most recently used first. *)
+    type entry = {
+      key : key;
+      ctx : t;
+      mutable prev : entry option;
+      mutable next : entry option;
+    }
+
+    type cache = {
+      threads : int;
+      capacity : int;
+      entries : (key, entry) Hashtbl.t;
+      mutable first : entry option;
+      mutable last : entry option;
+    }
+
+    type t = cache
+
+    let create ?(threads = 1) ?(capacity = 16) () =
+      if capacity < 1 then
+        raise (Error (`Failure "Swscale cache capacity must be positive"));
+      {
+        threads;
+        capacity;
+        entries = Hashtbl.create capacity;
+        first = None;
+        last = None;
+      }
+
+    let length cache = Hashtbl.length cache.entries
+
+    let clear cache =
+      Hashtbl.reset cache.entries;
+      cache.first <- None;
+      cache.last <- None
+
+    let unlink cache entry =
+      (match entry.prev with
+        | Some prev -> prev.next <- entry.next
+        | None -> cache.first <- entry.next);
+      (match entry.next with
+        | Some next -> next.prev <- entry.prev
+        | None -> cache.last <- entry.prev);
+      entry.prev <- None;
+      entry.next <- None
+
+    let push_front cache entry =
+      entry.next <- cache.first;
+      (match cache.first with
+        | Some first -> first.prev <- Some entry
+        | None -> cache.last <- Some entry);
+      cache.first <- Some entry
+
+    let get cache flags in_width in_height in_pixel_format out_width
+        out_height out_pixel_format =
+      let key =
+        ( flags,
+          in_width,
+          in_height,
+          in_pixel_format,
+          out_width,
+          out_height,
+          out_pixel_format )
+      in
+      match Hashtbl.find_opt cache.entries key with
+        | Some entry ->
+            unlink cache entry;
+            push_front cache entry;
+            entry.ctx
+        | None ->
+            let ctx =
+              create_context ~threads:cache.threads flags in_width in_height
+                in_pixel_format out_width out_height out_pixel_format
+            in
+            (* The evicted context is left to its holders, if any, and to the
+               GC. *)
+            (match cache.last with
+              | Some lru when Hashtbl.length cache.entries >= cache.capacity ->
+                  unlink cache lru;
+                  Hashtbl.remove cache.entries lru.key
+              | _ -> ());
+            let entry = { key; ctx; prev = None; next = None } in
+            Hashtbl.replace cache.entries key entry;
+            push_front cache entry;
+            ctx
+  end
 end
@@ -46,10 +46,20 @@ type ('i, 'o) ctx
 module Make (I : VideoData) (O : VideoData) : sig
   type t = (I.t, O.t) ctx
 
-  (** [Swscale.create flags in_w in_h in_pf out_w out_h out_pf] do the same as
-      {!Swscale.create}. *)
+  (** [Swscale.create ?threads flags in_w in_h in_pf out_w out_h out_pf] do the
+      same as {!Swscale.create}. Conversions are split into horizontal slices
+      scaled on [threads] native threads, [0] for one per core. Defaults to
+      [1]. Ignored with libswscale older than 6.1.100. *)
   val create :
-    flag list -> int -> int -> pixel_format -> int -> int -> pixel_format -> t
+    ?threads:int ->
+    flag list ->
+    int ->
+    int ->
+    pixel_format ->
+    int ->
+    int ->
+    pixel_format ->
+    t
 
   (*
   val from_codec : flag list -> video Avcodec.t -> int -> int -> pixel_format -> t
@@ -67,6 +77,72 @@ module Make (I : VideoData) (O : VideoData) : sig
 
       Raise Error if the conversion failed. *)
   val convert : t -> I.t -> O.t
+
+  (** [Swscale.convert_into ctx ivd ovd] does the same as [convert], writing
+      into [ovd] instead of allocating a new output, e.g. to reuse it from one
+      frame to the next. A frame output must have the context's output size
+      and format, and is made writable first. Bigarray outputs must be large
+      enough for their line sizes, plus 16 bytes that swscale may write past
+      the end of each plane.
+
+      Raise Error if [ovd] does not fit, for [Bytes] outputs, strings being
+      immutable, or if the conversion failed. *)
+  val convert_into : t -> I.t -> O.t -> unit
+
+  (** [Swscale.send_slice ctx ~y ~h ivd ovd] scales the output rows which
+      input rows [y] to [y + h - 1] of [ivd] make available, writing them into
+      [ovd] as [convert_into] does. This lets scaling start before the whole
+      input picture is there, e.g. while it is being decoded or captured.
+
+      Slices must be sent from top to bottom, a picture starting with the
+      slice at row [0], with the same [ivd] and [ovd] for all of its slices.
+      [ctx] keeps them alive until the next picture or conversion, and a frame
+      [ovd] must not be made writable in between. Returns the first output row
+      written and the number of rows written, which may be [0] until enough
+      input rows are available. The last slice completes the output.
+
+      Raise Error if the slice is out of order or out of the picture, if
+      [ivd] or [ovd] do not have the planes the picture started with, for
+      [Bytes] outputs, or if scaling failed. *)
+  val send_slice : t -> y:int -> h:int -> I.t -> O.t -> int * int
+
+  (** Contexts reused across conversion parameters, e.g. when the input size
+      changes mid-stream or for many thumbnail sizes. *)
+  module Cache : sig
+    type context := t
+    type t
+
+    (** [Swscale.Cache.create ?threads ?capacity ()] creates a cache holding
+        at most [capacity] contexts, [16] by default. Contexts are created with
+        [threads], see {!create}.
+
+        Raise Error if [capacity] is not positive. *)
+    val create : ?threads:int -> ?capacity:int -> unit -> t
+
+    (** [Swscale.Cache.get cache flags in_w in_h in_pf out_w out_h out_pf]
+        returns the cached context for these parameters, creating it if
+        needed. When the cache is full, the least recently used context is
+        dropped from it. It stays usable by whoever still holds it and is freed
+        once unreachable. Lookups take constant time.
+
+        Raise Error if the context cannot be created. *)
+    val get :
+      t ->
+      flag list ->
+      int ->
+      int ->
+      pixel_format ->
+      int ->
+      int ->
+      pixel_format ->
+      context
+
+    (** Number of contexts in the cache. *)
+    val length : t -> int
+
+    (** Drop all contexts. *)
+    val clear : t -> unit
+  end
 end
 
 (** Unsigned 8 bit bigarray split by planes. *)
@@ -20,6 +20,20 @@
 
 #define ALIGNMENT_BYTES 16
 
+// Some filters and swscale can read up to 16 bytes beyond the planes.
+#define OUT_PADDING 16
+
+/* Slice threading, through sws_scale_frame, appeared with the "threads"
+   option in libswscale 6.1.100. */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define HAVE_SWS_THREADS
+#endif
+
+/* So did sws_send_slice and sws_receive_slice. */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define HAVE_SWS_SLICES
+#endif
+
 CAMLprim value ocaml_swscale_version(value unit) {
   (void)unit;
   CAMLparam0();
@@ -190,14 +204,30 @@ typedef struct sws_t sws_t;
 
 struct sws_t {
   struct SwsContext *context;
+  int threads;
   int srcSliceY;
   int srcSliceH;
+  // Next input and output rows of the frame being scaled by slices.
+  int next_in_row;
+  int next_out_row;
+  // Planes of the frame being scaled by slices, which all slices must share.
+  uint8_t *picture_in[4];
+  int picture_in_stride[4];
+  uint8_t *picture_out[4];
+  int picture_out_stride[4];
+  // Frames of the current call, for frame inputs and outputs.
+  AVFrame *in_frame;
+  AVFrame *out_frame;
+  // Set while a slice other than the first of its picture is being sent.
+  int mid_picture;
   struct video_t in;
   struct video_t out;
 
   int (*get_in_pixels)(sws_t *, value *);
   int (*alloc_out)(sws_t *, value *, value *);
   int (*copy_out)(sws_t *, value *);
+  // Fills in the planes of a caller provided output.
+  int (*get_out_pixels)(sws_t *, value *, uint8_t *[4], int[4]);
 };
 
 #define Sws_val(v) (*(sws_t **)Data_custom_val(v))
@@ -205,6 +235,7 @@ struct sws_t {
 static int get_in_pixels_frame(sws_t *sws, value *in_vector) {
   AVFrame *frame = Frame_val(*in_vector);
 
+  sws->in_frame = frame;
   sws->in.slice = frame->data;
   sws->in.stride = frame->linesize;
 
@@ -336,9 +367,7 @@ static int alloc_out_ba(sws_t *sws, value *out_vect, value *tmp) {
   *out_vect = caml_alloc_tuple(sws->out.nb_planes);
 
   for (i = 0; i < sws->out.nb_planes; i++) {
-    // Some filters and swscale can read up to 16 bytes beyond the planes,
-    // 16 extra bytes must be allocated.
-    out_size = sws->out.plane_sizes[i] + 16;
+    out_size = sws->out.plane_sizes[i] + OUT_PADDING;
 
     *tmp = caml_alloc_tuple(2);
     Store_field(
@@ -363,9 +392,7 @@ static int alloc_out_packed_ba(sws_t *sws, value *out_vect, value *tmp) {
   Store_field(*out_vect, 1, caml_alloc_tuple(sws->out.nb_planes));
 
   for (i = 0; i < sws->out.nb_planes; i++) {
-    // Some filters and swscale can read up to 16 bytes beyond the planes,
-    // 16 extra bytes must be allocated.
-    out_size = sws->out.plane_sizes[i] + 16;
+    out_size = sws->out.plane_sizes[i] + OUT_PADDING;
 
     *tmp = caml_ba_alloc(CAML_BA_C_LAYOUT | CAML_BA_UINT8, 1, NULL, &out_size);
     Store_field(Field(*out_vect, 0), i, *tmp);
@@ -377,6 +404,205 @@ static int alloc_out_packed_ba(sws_t *sws, value *out_vect, value *tmp) {
   return 0;
 }
 
+#if defined(HAVE_SWS_THREADS) || defined(HAVE_SWS_SLICES)
+static void free_borrowed_buffer(void *opaque, uint8_t *data) {
+  (void)opaque;
+  (void)data;
+}
+
+/* sws_scale_frame wants reference counted frames: planes are lent to it
+   through buffers which do not own them. */
+static int borrow_planes(AVFrame *frame, struct video_t *video,
+                         uint8_t *const slice[4], const int stride[4]) {
+  int i;
+
+  frame->width = video->width;
+  frame->height = video->height;
+  frame->format = video->pixel_format;
+
+  for (i = 0; i < 4; i++) {
+    frame->data[i] = slice[i];
+    frame->linesize[i] = stride[i];
+  }
+
+  frame->buf[0] = av_buffer_create(slice[0], 1, free_borrowed_buffer, NULL,
+                                   AV_BUFFER_FLAG_READONLY);
+
+  return frame->buf[0] ? 0 : AVERROR(ENOMEM);
+}
+#endif
+
+#ifdef HAVE_SWS_THREADS
+static int scale_threaded(sws_t *sws, uint8_t *const dst[4],
+                          const int dst_stride[4]) {
+  AVFrame *src_frame = av_frame_alloc();
+  AVFrame *dst_frame = av_frame_alloc();
+  int ret = AVERROR(ENOMEM);
+
+  if (src_frame && dst_frame) {
+    ret = borrow_planes(src_frame, &sws->in, sws->in.slice, sws->in.stride);
+    if (ret >= 0)
+      ret = borrow_planes(dst_frame, &sws->out, dst, dst_stride);
+    if (ret >= 0)
+      ret = sws_scale_frame(sws->context, dst_frame, src_frame);
+  }
+
+  av_frame_free(&src_frame);
+  av_frame_free(&dst_frame);
+
+  return ret;
+}
+#endif
+
+/* Abandons any frame being scaled by slices. */
+static void end_slices(sws_t *sws) {
+#ifdef HAVE_SWS_SLICES
+  if (sws->next_in_row != 0)
+    sws_frame_end(sws->context);
+#endif
+  sws->next_in_row = 0;
+}
+
+/* Scales the input planes into [dst], on several threads when so
+   configured. Must be called without the runtime. */
+static int scale(sws_t *sws, uint8_t *const dst[4], const int dst_stride[4]) {
+  end_slices(sws);
+
+#ifdef HAVE_SWS_THREADS
+  if (sws->threads != 1)
+    return scale_threaded(sws, dst, dst_stride);
+#endif
+
+  return sws_scale(sws->context, (const uint8_t *const *)sws->in.slice,
+                   sws->in.stride, sws->srcSliceY, sws->srcSliceH, dst,
+                   dst_stride);
+}
+
+/* Checks that [nb_planes] planes of [sizes] bytes and [linesizes] hold
+   an output image, padded as the outputs allocated here. */
+static int check_out_planes(sws_t *sws, int nb_planes, const intnat *sizes,
+                            const int linesizes[4]) {
+  ptrdiff_t strides[4] = {0};
+  size_t plane_sizes[4];
+  int i, ret;
+
+  if (nb_planes != sws->out.nb_planes)
+    return AVERROR(EINVAL);
+
+  for (i = 0; i < nb_planes; i++) {
+    if (linesizes[i] <
+        av_image_get_linesize(sws->out.pixel_format, sws->out.width, i))
+      return AVERROR(EINVAL);
+    strides[i] = linesizes[i];
+  }
+
+  ret = av_image_fill_plane_sizes(plane_sizes, sws->out.pixel_format,
+                                  sws->out.height, strides);
+  if (ret < 0)
+    return ret;
+
+  for (i = 0; i < nb_planes; i++)
+    if (sizes[i] < 0 || (size_t)sizes[i] < plane_sizes[i] + OUT_PADDING)
+      return AVERROR(EINVAL);
+
+  return 0;
+}
+
+static int get_out_pixels_frame(sws_t *sws, value *out_vect,
+                                uint8_t *slice[4], int stride[4]) {
+  AVFrame *frame = Frame_val(*out_vect);
+  int i, ret;
+
+  if (frame->width != sws->out.width || frame->height != sws->out.height ||
+      frame->format != sws->out.pixel_format || !frame->buf[0])
+    return AVERROR(EINVAL);
+
+  /* Mid-picture, the context's own reference keeps the frame from being
+     writable: making it so would move it away from the picture. */
+  if (!sws->mid_picture) {
+    ret = ocaml_avutil_frame_make_writable(frame);
+    if (ret < 0)
+      return ret;
+  }
+
+  for (i = 0; i < 4; i++) {
+    slice[i] = frame->data[i];
+    stride[i] = frame->linesize[i];
+  }
+
+  sws->out_frame = frame;
+
+  return 0;
+}
+
+static int get_out_pixels_ba(sws_t *sws, value *out_vect, uint8_t *slice[4],
+                             int stride[4]) {
+  int i, nb_planes = Wosize_val(*out_vect);
+  intnat sizes[4];
+  value v;
+
+  if (nb_planes > 4)
+    return AVERROR(EINVAL);
+
+  for (i = 0; i < nb_planes; i++) {
+    v = Field(*out_vect, i);
+    slice[i] = Caml_ba_data_val(Field(v, 0));
+    sizes[i] = Caml_ba_array_val(Field(v, 0))->dim[0];
+    stride[i] = Int_val(Field(v, 1));
+  }
+
+  return check_out_planes(sws, nb_planes, sizes, stride);
+}
+
+static int get_out_pixels_packed_ba(sws_t *sws, value *out_vect,
+                                    uint8_t *slice[4], int stride[4]) {
+  int i, nb_planes = Wosize_val(Field(*out_vect, 0));
+  intnat sizes[4];
+  value v;
+
+  if (nb_planes > 4 || Wosize_val(Field(*out_vect, 1)) != nb_planes)
+    return AVERROR(EINVAL);
+
+  for (i = 0; i < nb_planes; i++) {
+    v = Field(Field(*out_vect, 0), i);
+    slice[i] = Caml_ba_data_val(v);
+    sizes[i] = Caml_ba_array_val(v)->dim[0];
+    stride[i] = Int_val(Field(Field(*out_vect, 1), i));
+  }
+
+  return check_out_planes(sws, nb_planes, sizes, stride);
+}
+
+CAMLprim value ocaml_swscale_convert_into(value _sws, value _in_vector,
+                                          value _out_vect) {
+  CAMLparam3(_sws, _in_vector, _out_vect);
+  sws_t *sws = Sws_val(_sws);
+  uint8_t *slice[4] = {NULL};
+  int stride[4] = {0};
+  int ret;
+
+  // Strings are immutable.
+  if (!sws->get_out_pixels)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  ret = sws->get_out_pixels(sws, &_out_vect, slice, stride);
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  ret = sws->get_in_pixels(sws, &_in_vector);
+  if (ret < 0)
+    Fail("Failed to get input pixels");
+
+  caml_release_runtime_system();
+  ret = scale(sws, slice, stride);
+  caml_acquire_runtime_system();
+
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  CAMLreturn(Val_unit);
+}
+
 CAMLprim value ocaml_swscale_convert(value _sws, value _in_vector) {
   CAMLparam2(_sws, _in_vector);
   CAMLlocal2(out_vect, tmp);
@@ -393,9 +619,7 @@ CAMLprim value ocaml_swscale_convert(value _sws, value _in_vector) {
 
   // Scale and convert input data to output data
   caml_release_runtime_system();
-  ret = sws_scale(sws->context, (const uint8_t *const *)sws->in.slice,
-                  sws->in.stride, sws->srcSliceY, sws->srcSliceH,
-                  sws->out.slice, sws->out.stride);
+  ret = scale(sws, sws->out.slice, sws->out.stride);
   caml_acquire_runtime_system();
 
   if (ret < 0)
@@ -410,6 +634,186 @@ CAMLprim value ocaml_swscale_convert(value _sws, value _in_vector) {
   CAMLreturn(out_vect);
 }
 
+#ifdef HAVE_SWS_SLICES
+/* The context references both frames until the picture is complete. Frame
+   inputs and outputs are referenced as they are, so that their buffers stay
+   alive. Other planes are borrowed: their OCaml values are held by the
+   context's OCaml side until then. */
+static int start_slices(sws_t *sws, uint8_t *const dst[4],
+                        const int dst_stride[4]) {
+  AVFrame *src_frame = av_frame_alloc();
+  AVFrame *dst_frame = av_frame_alloc();
+  int ret = AVERROR(ENOMEM);
+
+  /* Drop whatever is left of an unfinished frame. */
+  sws_frame_end(sws->context);
+
+  if (src_frame && dst_frame) {
+    if (sws->in_frame)
+      ret = av_frame_ref(src_frame, sws->in_frame);
+    else
+      ret = borrow_planes(src_frame, &sws->in, sws->in.slice, sws->in.stride);
+    if (ret >= 0) {
+      if (sws->out_frame)
+        ret = av_frame_ref(dst_frame, sws->out_frame);
+      else
+        ret = borrow_planes(dst_frame, &sws->out, dst, dst_stride);
+    }
+    if (ret >= 0)
+      ret = sws_frame_start(sws->context, dst_frame, src_frame);
+  }
+
+  av_frame_free(&src_frame);
+  av_frame_free(&dst_frame);
+
+  return ret;
+}
+
+/* Scales the output rows made available by input rows [y, y + h). Returns
+   the number of output rows written from [sws->next_out_row]. */
+static int scale_slice(sws_t *sws, uint8_t *const dst[4],
+                       const int dst_stride[4], int y, int h) {
+  unsigned int alignment;
+  int ret, rows, start = sws->next_out_row;
+
+  if (y == 0) {
+    ret = start_slices(sws, dst, dst_stride);
+    if (ret < 0)
+      return ret;
+  }
+
+  ret = sws_send_slice(sws->context, y, h);
+  if (ret < 0)
+    return ret;
+
+  /* Output rows are requested by multiples of the alignment, in chunks large
+     enough to keep the per call overhead low. */
+  alignment = sws_receive_slice_alignment(sws->context);
+  if (alignment < 1)
+    alignment = 1;
+  rows = ((16 + alignment - 1) / alignment) * alignment;
+
+  while (sws->next_out_row < sws->out.height) {
+    if (rows > sws->out.height - sws->next_out_row)
+      rows = sws->out.height - sws->next_out_row;
+
+    ret = sws_receive_slice(sws->context, sws->next_out_row, rows);
+    if (ret == AVERROR(EAGAIN))
+      break;
+    if (ret < 0)
+      return ret;
+
+    sws->next_out_row += rows;
+  }
+
+  if (sws->next_out_row == sws->out.height)
+    sws_frame_end(sws->context);
+
+  return sws->next_out_row - start;
+}
+#else
+static int scale_slice(sws_t *sws, uint8_t *const dst[4],
+                       const int dst_stride[4], int y, int h) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(sws->in.pixel_format);
+  const uint8_t *src[4] = {NULL};
+  int i, ret, shift;
+
+  if (!desc)
+    return AVERROR(EINVAL);
+
+  /* sws_scale wants pointers to the first row of the slice, output planes
+     being whole pictures. */
+  for (i = 0; i < 4 && sws->in.slice[i]; i++) {
+    shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+    src[i] = sws->in.slice[i] + (y >> shift) * sws->in.stride[i];
+  }
+
+  ret = sws_scale(sws->context, src, sws->in.stride, y, h, dst, dst_stride);
+  if (ret < 0)
+    return ret;
+
+  sws->next_out_row += ret;
+
+  return ret;
+}
+#endif
+
+CAMLprim value ocaml_swscale_send_slice(value _sws, value _in_vector,
+                                        value _out_vect, value _y, value _h) {
+  CAMLparam5(_sws, _in_vector, _out_vect, _y, _h);
+  CAMLlocal1(ans);
+  sws_t *sws = Sws_val(_sws);
+  uint8_t *slice[4] = {NULL};
+  int stride[4] = {0};
+  int y = Int_val(_y);
+  int h = Int_val(_h);
+  int i, ret, start;
+
+  // Strings are immutable.
+  if (!sws->get_out_pixels || !sws->context)
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  /* Slices go from top to bottom, a frame starting at row 0. */
+  if (y < 0 || h <= 0 || y + h > sws->in.height ||
+      (y != 0 && y != sws->next_in_row))
+    ocaml_avutil_raise_error(AVERROR(EINVAL));
+
+  /* A new picture releases the previous one's frames first, so that they
+     can be made writable again. */
+  if (y == 0)
+    end_slices(sws);
+
+  sws->in_frame = NULL;
+  sws->out_frame = NULL;
+  sws->mid_picture = y != 0;
+
+  ret = sws->get_out_pixels(sws, &_out_vect, slice, stride);
+  sws->mid_picture = 0;
+  if (ret < 0)
+    ocaml_avutil_raise_error(ret);
+
+  ret = sws->get_in_pixels(sws, &_in_vector);
+  if (ret < 0)
+    Fail("Failed to get input pixels");
+
+  if (y == 0) {
+    sws->next_out_row = 0;
+    for (i = 0; i < 4; i++) {
+      sws->picture_in[i] = sws->in.slice[i];
+      sws->picture_in_stride[i] = sws->in.stride[i];
+      sws->picture_out[i] = slice[i];
+      sws->picture_out_stride[i] = stride[i];
+    }
+  } else {
+    /* The context still works on the planes the picture started with. */
+    for (i = 0; i < 4; i++)
+      if (sws->picture_in[i] != sws->in.slice[i] ||
+          sws->picture_in_stride[i] != sws->in.stride[i] ||
+          sws->picture_out[i] != slice[i] ||
+          sws->picture_out_stride[i] != stride[i])
+        ocaml_avutil_raise_error(AVERROR(EINVAL));
+  }
+  start = sws->next_out_row;
+
+  caml_release_runtime_system();
+  ret = scale_slice(sws, slice, stride, y, h);
+  caml_acquire_runtime_system();
+
+  if (ret < 0) {
+    /* The frame has to be started over. */
+    sws->next_in_row = -1;
+    ocaml_avutil_raise_error(ret);
+  }
+
+  sws->next_in_row = y + h;
+
+  ans = caml_alloc_tuple(2);
+  Store_field(ans, 0, Val_int(start));
+  Store_field(ans, 1, Val_int(ret));
+
+  CAMLreturn(ans);
+}
+
 void swscale_free(sws_t *sws) {
   int i;
 
@@ -440,14 +844,74 @@ static struct custom_operations sws_ops = {
     custom_serialize_default,   custom_deserialize_default,
     custom_compare_ext_default, custom_fixed_length_default};
 
-CAMLprim value ocaml_swscale_create(value flags_, value in_vector_kind_,
-                                    value in_width_, value in_height_,
-                                    value in_pixel_format_,
+#ifdef HAVE_SWS_THREADS
+static struct SwsContext *get_threaded_context(sws_t *sws, int flags) {
+  struct SwsContext *c = sws_alloc_context();
+
+  if (!c)
+    return NULL;
+
+  if (av_opt_set_int(c, "srcw", sws->in.width, 0) < 0 ||
+      av_opt_set_int(c, "srch", sws->in.height, 0) < 0 ||
+      av_opt_set_int(c, "src_format", sws->in.pixel_format, 0) < 0 ||
+      av_opt_set_int(c, "dstw", sws->out.width, 0) < 0 ||
+      av_opt_set_int(c, "dsth", sws->out.height, 0) < 0 ||
+      av_opt_set_int(c, "dst_format", sws->out.pixel_format, 0) < 0 ||
+      av_opt_set_int(c, "sws_flags", flags, 0) < 0 ||
+      av_opt_set_int(c, "threads", sws->threads, 0) < 0 ||
+      sws_init_context(c, NULL, NULL) < 0) {
+    sws_freeContext(c);
+    return NULL;
+  }
+
+  return c;
+}
+#endif
+
+/* Creates the context for the current parameters. Must be called without
+   the runtime. */
+static struct SwsContext *get_context(sws_t *sws, int flags) {
+#ifdef HAVE_SWS_THREADS
+  if (sws->threads != 1)
+    return get_threaded_context(sws, flags);
+#endif
+
+  return sws_getContext(sws->in.width, sws->in.height, sws->in.pixel_format,
+                        sws->out.width, sws->out.height, sws->out.pixel_format,
+                        flags, NULL, NULL, NULL);
+}
+
+static int set_out_sizes(sws_t *sws) {
+  ptrdiff_t linesizes[4];
+  int i, ret;
+
+  ret = av_image_fill_linesizes(sws->out.stride, sws->out.pixel_format,
+                                sws->out.width);
+  if (ret < 0)
+    return ret;
+
+  for (i = 0; i < 4; i++)
+    linesizes[i] = sws->out.stride[i];
+
+  ret = av_image_fill_plane_sizes(sws->out.plane_sizes, sws->out.pixel_format,
+                                  sws->out.height, linesizes);
+  if (ret < 0)
+    return ret;
+
+  sws->out.nb_planes = av_pix_fmt_count_planes(sws->out.pixel_format);
+
+  return 0;
+}
+
+CAMLprim value ocaml_swscale_create(value flags_, value threads_,
+                                    value in_vector_kind_, value in_width_,
+                                    value in_height_, value in_pixel_format_,
                                     value out_vect_kind_, value out_width_,
                                     value out_height_,
                                     value out_pixel_format_) {
-  CAMLparam5(flags_, in_vector_kind_, in_width_, in_height_, in_pixel_format_);
-  CAMLxparam4(out_vect_kind_, out_width_, out_height_, out_pixel_format_);
+  CAMLparam5(flags_, threads_, in_vector_kind_, in_width_, in_height_);
+  CAMLxparam5(in_pixel_format_, out_vect_kind_, out_width_, out_height_,
+              out_pixel_format_);
   CAMLlocal1(ans);
   vector_kind in_vector_kind = Int_val(in_vector_kind_);
   vector_kind out_vect_kind = Int_val(out_vect_kind_);
@@ -477,10 +941,14 @@ CAMLprim value ocaml_swscale_create(value flags_, value in_vector_kind_,
   for (i = 0; i < (int)Wosize_val(flags_); i++)
     flags |= Flag_val(Field(flags_, i));
 
+#ifdef HAVE_SWS_THREADS
+  sws->threads = Int_val(threads_) < 0 ? 1 : Int_val(threads_);
+#else
+  sws->threads = 1;
+#endif
+
   caml_release_runtime_system();
-  sws->context = sws_getContext(
-      sws->in.width, sws->in.height, sws->in.pixel_format, sws->out.width,
-      sws->out.height, sws->out.pixel_format, flags, NULL, NULL, NULL);
+  sws->context = get_context(sws, flags);
   caml_acquire_runtime_system();
 
   if (!sws->context) {
@@ -501,38 +969,24 @@ CAMLprim value ocaml_swscale_create(value flags_, value in_vector_kind_,
 
   if (out_vect_kind == Frm) {
     sws->alloc_out = alloc_out_frame;
+    sws->get_out_pixels = get_out_pixels_frame;
   } else if (out_vect_kind == Str) {
     sws->alloc_out = alloc_out_string;
     sws->copy_out = copy_out_string;
     sws->out.owns_data = 1;
   } else if (out_vect_kind == PackedBa) {
     sws->alloc_out = alloc_out_packed_ba;
+    sws->get_out_pixels = get_out_pixels_packed_ba;
   } else {
     sws->alloc_out = alloc_out_ba;
+    sws->get_out_pixels = get_out_pixels_ba;
   }
 
-  int ret = av_image_fill_linesizes(sws->out.stride, sws->out.pixel_format,
-                                    sws->out.width);
-
-  if (ret < 0) {
+  if (set_out_sizes(sws) < 0) {
     swscale_free(sws);
     Fail("Failed to create Swscale context");
   }
 
-  ptrdiff_t linesizes[4];
-  for (i = 0; i < 4; i++)
-    linesizes[i] = sws->out.stride[i];
-
-  ret = av_image_fill_plane_sizes(sws->out.plane_sizes, sws->out.pixel_format,
-                                  sws->out.height, linesizes);
-
-  if (ret < 0) {
-    swscale_free(sws);
-    Fail("Failed to create Swscale context");
-  }
-
-  sws->out.nb_planes = av_pix_fmt_count_planes(sws->out.pixel_format);
-
   ans = caml_alloc_custom(&sws_ops, sizeof(sws_t *), 0, 1);
   Sws_val(ans) = sws;
 
@@ -542,5 +996,5 @@ CAMLprim value ocaml_swscale_create(value flags_, value in_vector_kind_,
 CAMLprim value ocaml_swscale_create_byte(value *argv, int argn) {
   (void)argn;
   return ocaml_swscale_create(argv[0], argv[1], argv[2], argv[3], argv[4],
-                              argv[5], argv[6], argv[7], argv[8]);
+                              argv[5], argv[6], argv[7], argv[8], argv[9]);
 }
@@ -0,0 +1,94 @@
+(* [Avutil.Audio] mix, gain and levels, checked against the same
+   computations done on the planes, in float and integer formats. *)
+
+open Avutil
+
+let rate = 48000
+let stereo = Channel_layout.stereo
+let nb_samples = 1500
+
+let float_frame sample_format value =
+  let frame = Audio.create_frame sample_format stereo rate nb_samples in
+  Array.iter
+    (fun plane ->
+      for i = 0 to Bigarray.Array1.dim plane - 1 do
+        plane.{i} <- value i
+      done)
+    (Audio.frame_planes ~make_writable:true Bigarray.float32 frame);
+  frame
+
+let check_samples what frame want =
+  let bad = ref 0 in
+  Array.iter
+    (fun plane ->
+      for i = 0 to Bigarray.Array1.dim plane - 1 do
+        if Float.abs (plane.{i} -. want i) > 1e-5 then incr bad
+      done)
+    (Audio.frame_planes Bigarray.float32 frame);
+  Test_assert.checkf (!bad = 0) "%s: %d samples off" what !bad
+
+let () =
+  List.iter
+    (fun sample_format ->
+      let a = float_frame sample_format (fun _ -> 0.25) in
+      let b = float_frame sample_format (fun i -> float (i mod 4) /. 8.) in
+      Frame.set_pts a (Some 42L);
+      let mix = Audio.mix ~gains:[| 2.; -1. |] [| a; b |] in
+      Test_assert.check "mix pts" (Frame.pts mix = Some 42L);
+      check_samples "mix" mix (fun i -> 0.5 -. (float (i mod 4) /. 8.));
+
+      Audio.gain b 0.5;
+      check_samples "gain" b (fun i -> float (i mod 4) /. 16.);
+
+      (* Interleaved samples share their gain. *)
+      let channels = if sample_format = `Flt then 2 else 1 in
+      let step = 1. /. float nb_samples in
+      Audio.ramp a 0. 1.;
+      check_samples "ramp" a (fun i ->
+          0.25 *. float (i / channels) *. step))
+    [`Fltp; `Flt];
+
+  (* Integer formats saturate. *)
+  let frame = Audio.create_frame `S16 stereo rate nb_samples in
+  let plane =
+    (Audio.frame_planes ~make_writable:true Bigarray.int16_signed frame).(0)
+  in
+  Bigarray.Array1.fill plane 16384;
+  let mix = Audio.mix [| frame; frame; frame |] in
+  let plane = (Audio.frame_planes Bigarray.int16_signed mix).(0) in
+  Test_assert.checkf (plane.{0} = 32767) "s16 saturation: %d" plane.{0};
+
+  let levels = Audio.levels frame in
+  Test_assert.checkf
+    (Array.length levels = 2
+    && levels.(0).peak = 0.5
+    && Float.abs (levels.(1).rms -. 0.5) < 1e-6)
+    "s16 levels: %d channels, peak %f, rms %f" (Array.length levels)
+    levels.(0).peak levels.(1).rms;
+
+  Test_assert.check "mismatched frames are rejected"
+    (try
+       ignore
+         (Audio.mix
+            [| frame; Audio.create_frame `S16 stereo rate (nb_samples / 2) |]);
+       false
+     with Error _ -> true);
+
+  (* A full scale 1kHz sine reads -3.01 LUFS on one channel, once the
+     filters have settled. *)
+  let sine nb_samples =
+    let frame = Audio.create_frame `Flt Channel_layout.mono rate nb_samples in
+    let plane =
+      (Audio.frame_planes ~make_writable:true Bigarray.float32 frame).(0)
+    in
+    for i = 0 to nb_samples - 1 do
+      plane.{i} <- sin (2. *. Float.pi *. 1000. *. float i /. float rate)
+    done;
+    frame
+  in
+  let meter = Audio.Loudness.create Channel_layout.mono rate in
+  ignore (Audio.Loudness.process meter (sine rate));
+  let lufs = Audio.Loudness.process meter (sine (rate * 4 / 10)) in
+  Test_assert.checkf (Float.abs (lufs +. 3.01) < 0.05) "sine: %f LUFS" lufs;
+
+  Test_assert.finish ()
@@ -0,0 +1,74 @@
+(* Re-chunking through [Avutil.Audio.Fifo]: sample counts, pts carried over
+   from the written frames, and partial reads at end of stream. *)
+
+open Avutil
+
+let rate = 48000
+let stereo = Channel_layout.stereo
+
+let frame ~pts nb_samples =
+  let frame = Audio.create_frame `S16 stereo rate nb_samples in
+  Frame.set_pts frame (Some pts);
+  frame
+
+let check_read what fifo ?partial n ~want ~pts =
+  match Audio.Fifo.read ?partial fifo n with
+    | None -> Test_assert.checkf (want = 0) "%s: nothing read" what
+    | Some frame ->
+        let got = Audio.frame_nb_samples frame in
+        Test_assert.checkf (got = want) "%s: %d samples, want %d" what got
+          want;
+        Test_assert.checkf
+          (Frame.pts frame = Some pts)
+          "%s: pts %s, want %Ld" what
+          (match Frame.pts frame with
+            | Some pts -> Int64.to_string pts
+            | None -> "none")
+          pts
+
+let () =
+  let fifo = Audio.Fifo.create `S16 stereo rate in
+  List.iter
+    (fun pts -> Audio.Fifo.write_frame fifo (frame ~pts 1000))
+    [0L; 1000L; 2000L];
+  Test_assert.checkf
+    (Audio.Fifo.size fifo = 3000)
+    "size after writes: %d" (Audio.Fifo.size fifo);
+
+  check_read "first" fifo 1024 ~want:1024 ~pts:0L;
+  check_read "second" fifo 1024 ~want:1024 ~pts:1024L;
+  check_read "short" fifo 1024 ~want:0 ~pts:0L;
+  check_read "partial" fifo ~partial:true 1024 ~want:952 ~pts:2048L;
+  check_read "empty" fifo ~partial:true 1024 ~want:0 ~pts:0L;
+
+  (* Timestamps follow [time_base], not samples. *)
+  let fifo =
+    Audio.Fifo.create ~time_base:{ num = 1; den = 1000 } `S16 stereo rate
+  in
+  Audio.Fifo.write_frame fifo (frame ~pts:500L 4800);
+  check_read "time_base" fifo 2400 ~want:2400 ~pts:500L;
+  check_read "time_base rescaled" fifo 2400 ~want:2400 ~pts:550L;
+
+  (* Planar bigarrays: one plane per channel. *)
+  let fifo = Audio.Fifo.create `Fltp stereo rate in
+  let plane () = create_data (4 * 256) in
+  Audio.Fifo.write ~pts:0L ~offset:56 fifo [| plane (); plane () |];
+  Test_assert.checkf
+    (Audio.Fifo.size fifo = 200)
+    "size after planar write: %d" (Audio.Fifo.size fifo);
+  Test_assert.check "offset past the end is rejected"
+    (try
+       Audio.Fifo.write ~offset:300 fifo [| plane (); plane () |];
+       false
+     with Error _ -> true);
+  Test_assert.checkf
+    (Audio.Fifo.size fifo = 200)
+    "size after rejected write: %d" (Audio.Fifo.size fifo);
+
+  Test_assert.check "mismatched format is rejected"
+    (try
+       Audio.Fifo.write_frame fifo (frame ~pts:0L 16);
+       false
+     with Error _ -> true);
+
+  Test_assert.finish ()
@@ -0,0 +1,63 @@
+(* Frames built on user bigarrays share their data both ways and keep the
+   bigarrays alive. *)
+
+open Avutil
+
+let () =
+  let w = 64 and h = 48 in
+  let plane size value =
+    let data = create_data size in
+    Bigarray.Array1.fill data value;
+    data
+  in
+  let luma = plane (w * h) 0x10 in
+  let frame =
+    Video.frame_of_bigarrays w h `Yuv420p
+      [|
+        (luma, w);
+        (plane (w * h / 4) 0x80, w / 2);
+        (plane (w * h / 4) 0x80, w / 2);
+      |]
+  in
+  Gc.full_major ();
+  let planes = Video.frame_planes frame in
+  Test_assert.checkf
+    (Array.length planes = 3 && Video.frame_get_linesize frame 1 = w / 2)
+    "video: %d planes" (Array.length planes);
+  let data, _ = planes.(2) in
+  Test_assert.check "video: chroma kept alive" (data.{0} = 0x80);
+  luma.{0} <- 0x20;
+  let data, _ = planes.(0) in
+  Test_assert.check "video: shared" (data.{0} = 0x20);
+
+  Test_assert.check "short plane is rejected"
+    (try
+       ignore
+         (Video.frame_of_bigarrays w h `Yuv420p
+            [| (luma, w); (luma, w / 2); (plane 16 0, w / 2) |]);
+       false
+     with Error _ -> true);
+
+  let samples =
+    Bigarray.Array1.create Bigarray.int16_signed Bigarray.c_layout 2048
+  in
+  Bigarray.Array1.fill samples 1000;
+  let frame =
+    Audio.frame_of_bigarray `S16 Channel_layout.stereo 48000 [| samples |]
+  in
+  Test_assert.checkf
+    (Audio.frame_nb_samples frame = 1024)
+    "audio: %d samples" (Audio.frame_nb_samples frame);
+  Audio.gain frame 2.;
+  Test_assert.checkf (samples.{2047} = 2000) "audio: written through: %d"
+    samples.{2047};
+
+  Test_assert.check "mismatched kind is rejected"
+    (try
+       ignore
+         (Audio.frame_of_bigarray `Fltp Channel_layout.stereo 48000
+            [| samples; samples |]);
+       false
+     with Error _ -> true);
+
+  Test_assert.finish ()
@@ -0,0 +1,73 @@
+(* [Avdevice.Capture] on the lavfi device: packets come out until the end of
+   the source, every captured packet is either read or counted as an
+   overrun, and the container can only be used again once the capture is
+   stopped. *)
+
+module Capture = Avdevice.Capture
+
+let open_sine args =
+  let format = Option.get (Av.Format.find_input_format "lavfi") in
+  Av.open_input ~format ("sine=frequency=440:sample_rate=48000" ^ args)
+
+let raises what f =
+  match f () with
+    | _ -> Test_assert.check what false
+    | exception Avutil.Error (`Failure _) -> Test_assert.check what true
+
+let rec read_all capture n =
+  match Capture.read ~block:true capture with
+    | `Packet (`Audio_packet _, time) ->
+        Test_assert.checkf
+          (time <= Capture.now ())
+          "packet %d captured in the future" n;
+        read_all capture (n + 1)
+    | `Packet _ -> read_all capture n
+    | `Eagain ->
+        Test_assert.check "blocking read: `Eagain" false;
+        n
+    | `Eof -> n
+
+let () =
+  (* A finite source: the capture ends with it. *)
+  let container = open_sine ":duration=1" in
+  let capture = Capture.start ~capacity:4 container in
+  raises "read_input while capturing" (fun () -> Av.read_input container);
+  raises "close while capturing" (fun () -> Av.close container);
+  raises "start twice" (fun () -> Capture.start container);
+  let nb_read = read_all capture 0 in
+  let { Capture.captured; overruns; queued; latency_avg; latency_max } =
+    Capture.stats capture
+  in
+  Test_assert.checkf (nb_read > 0) "read %d packets" nb_read;
+  Test_assert.checkf
+    (captured = nb_read + overruns)
+    "stats: %d captured, %d read, %d overruns" captured nb_read overruns;
+  Test_assert.checkf (queued = 0) "stats: %d queued" queued;
+  Test_assert.checkf
+    (latency_avg >= 0. && latency_max >= latency_avg)
+    "stats: latency %f average, %f max" latency_avg latency_max;
+  Capture.stop capture;
+  Capture.stop capture;
+  Av.close container;
+
+  (* An endless source: [stop] ends the capture, what was queued can still
+     be read, and the container reads on its own again. *)
+  let container = open_sine "" in
+  let capture = Capture.start container in
+  (match Capture.read ~block:true capture with
+    | `Packet _ -> Test_assert.check "endless: first packet" true
+    | `Eagain | `Eof -> Test_assert.check "endless: first packet" false);
+  Capture.stop capture;
+  let nb_read = read_all capture 0 in
+  let { Capture.captured; overruns; _ } = Capture.stats capture in
+  Test_assert.checkf
+    (captured = nb_read + 1 + overruns)
+    "endless: %d captured, %d read after stop, %d overruns" captured nb_read
+    overruns;
+  let _, stream, _ = List.hd (Av.get_audio_streams container) in
+  (match Av.read_input ~audio_packet:[stream] container with
+    | `Audio_packet _ -> Test_assert.check "read_input after stop" true
+    | _ -> Test_assert.check "read_input after stop" false);
+  Av.close container;
+
+  Test_assert.finish ()
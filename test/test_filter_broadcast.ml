@@ -0,0 +1,152 @@
+(* [Avfilter.Broadcast]: every consumer sees every frame, in order, until its
+   queue is full, where the policy decides which frames it misses. With
+   [`Block], [pump] waits for consumers taking from other threads, or for
+   them to be unsubscribed. *)
+
+let rate = 48000
+let nb_samples = 256
+
+let graph () =
+  let config = Avfilter.init () in
+  let args =
+    [
+      `Pair ("sample_rate", `Int rate);
+      `Pair ("time_base", `Rational { Avutil.num = 1; den = rate });
+      `Pair ("channel_layout", `String "stereo");
+      `Pair ("sample_fmt", `Int (Avutil.Sample_format.get_id `Flt));
+    ]
+  in
+  let src = Avfilter.(attach ~args ~name:"src" abuffer config) in
+  let sink = Avfilter.(attach ~name:"sink" abuffersink config) in
+  Avfilter.link
+    (List.hd Avfilter.(src.io.outputs.audio))
+    (List.hd Avfilter.(sink.io.inputs.audio));
+  let graph = Avfilter.launch config in
+  ( snd (List.hd Avfilter.(graph.inputs.audio)),
+    snd (List.hd Avfilter.(graph.outputs.audio)) )
+
+let push input first n =
+  for i = first to first + n - 1 do
+    let frame =
+      Avutil.Audio.create_frame `Flt Avutil.Channel_layout.stereo rate
+        nb_samples
+    in
+    Avutil.Frame.set_pts frame (Some (Int64.of_int i));
+    input (`Frame frame)
+  done
+
+let rec take_all consumer =
+  match Avfilter.Broadcast.take consumer with
+    | `Frame frame ->
+        Option.get (Avutil.Frame.pts frame) :: take_all consumer
+    | `Eagain | `Eof -> []
+
+(* Takes [n] frames from another thread, as they are pumped. *)
+let consume consumer n =
+  let got = ref [] in
+  let rec take n =
+    if n > 0 then (
+      match Avfilter.Broadcast.take consumer with
+        | `Frame frame ->
+            got := Option.get (Avutil.Frame.pts frame) :: !got;
+            take (n - 1)
+        | `Eagain ->
+            Thread.delay 0.001;
+            take n
+        | `Eof -> ())
+  in
+  let thread = Thread.create take n in
+  fun () ->
+    Thread.join thread;
+    List.rev !got
+
+let check what consumer ~want ~dropped =
+  let got = take_all consumer in
+  Test_assert.checkf (got = want) "%s: got pts [%s]" what
+    (String.concat "; " (List.map Int64.to_string got));
+  Test_assert.checkf
+    (Avfilter.Broadcast.dropped consumer = dropped)
+    "%s: %d dropped, want %d" what
+    (Avfilter.Broadcast.dropped consumer)
+    dropped
+
+let () =
+  let input, output = graph () in
+  let broadcast = output.Avfilter.broadcast ~capacity:2 () in
+  let a = Avfilter.Broadcast.subscribe broadcast in
+  let b = Avfilter.Broadcast.subscribe broadcast in
+  push input 0 3;
+  Test_assert.check "pump: sink drained"
+    (Avfilter.Broadcast.pump broadcast = `Eagain);
+  Test_assert.checkf
+    (Avfilter.Broadcast.pending a = 2)
+    "pending: %d" (Avfilter.Broadcast.pending a);
+  check "drop oldest, a" a ~want:[1L; 2L] ~dropped:1;
+  check "drop oldest, b" b ~want:[1L; 2L] ~dropped:1;
+
+  (* An unsubscribed consumer no longer holds frames. *)
+  Avfilter.Broadcast.unsubscribe b;
+  push input 3 1;
+  ignore (Avfilter.Broadcast.pump broadcast);
+  Test_assert.check "unsubscribed: nothing queued"
+    (Avfilter.Broadcast.pending b = 0);
+  check "after unsubscribe, a" a ~want:[3L] ~dropped:1;
+
+  input `Flush;
+  Test_assert.check "pump: end of stream"
+    (Avfilter.Broadcast.pump broadcast = `Eof);
+  Test_assert.check "take: end of stream"
+    (Avfilter.Broadcast.take a = `Eof);
+
+  let input, output = graph () in
+  let broadcast =
+    output.Avfilter.broadcast ~capacity:2 ~policy:`Drop_newest ()
+  in
+  let a = Avfilter.Broadcast.subscribe broadcast in
+  push input 0 3;
+  ignore (Avfilter.Broadcast.pump broadcast);
+  check "drop newest" a ~want:[0L; 1L] ~dropped:1;
+
+  (* Five frames through a queue of two lose none: [pump] waits while the
+     consumer is full. *)
+  let input, output = graph () in
+  let broadcast = output.Avfilter.broadcast ~capacity:2 ~policy:`Block () in
+  let a = Avfilter.Broadcast.subscribe broadcast in
+  push input 0 5;
+  let got = consume a 5 in
+  Test_assert.check "block: pump returns once consumed"
+    (Avfilter.Broadcast.pump broadcast = `Eagain);
+  let got = got () in
+  Test_assert.checkf
+    (got = [0L; 1L; 2L; 3L; 4L])
+    "block: got pts [%s]"
+    (String.concat "; " (List.map Int64.to_string got));
+  Test_assert.checkf
+    (Avfilter.Broadcast.dropped a = 0)
+    "block: %d dropped" (Avfilter.Broadcast.dropped a);
+
+  (* A consumer which never takes stops holding [pump] up once it is
+     unsubscribed. *)
+  let input, output = graph () in
+  let broadcast = output.Avfilter.broadcast ~capacity:1 ~policy:`Block () in
+  let a = Avfilter.Broadcast.subscribe broadcast in
+  let b = Avfilter.Broadcast.subscribe broadcast in
+  push input 0 3;
+  let got = consume a 3 in
+  let unsubscriber =
+    Thread.create
+      (fun () ->
+        Thread.delay 0.05;
+        Avfilter.Broadcast.unsubscribe b)
+      ()
+  in
+  Test_assert.check "block: pump returns once unsubscribed"
+    (Avfilter.Broadcast.pump broadcast = `Eagain);
+  Thread.join unsubscriber;
+  let got = got () in
+  Test_assert.checkf (got = [0L; 1L; 2L]) "block, unsubscribe: got pts [%s]"
+    (String.concat "; " (List.map Int64.to_string got));
+  Test_assert.check "block, unsubscribe: nothing queued"
+    (Avfilter.Broadcast.pending b = 0);
+
+  Test_assert.finish ()
@@ -0,0 +1,108 @@
+(* [pull] and [drain] on a sink report [`Eagain] and [`Eof] as values, hand
+   back every queued frame, and pull into the frames passed as [~into]. *)
+
+let rate = 48000
+let nb_samples = 512
+
+let graph () =
+  let config = Avfilter.init () in
+  let args =
+    [
+      `Pair ("sample_rate", `Int rate);
+      `Pair ("time_base", `Rational { Avutil.num = 1; den = rate });
+      `Pair ("channel_layout", `String "stereo");
+      `Pair ("sample_fmt", `Int (Avutil.Sample_format.get_id `Flt));
+    ]
+  in
+  let src = Avfilter.(attach ~args ~name:"src" abuffer config) in
+  let sink = Avfilter.(attach ~name:"sink" abuffersink config) in
+  Avfilter.link
+    (List.hd Avfilter.(src.io.outputs.audio))
+    (List.hd Avfilter.(sink.io.inputs.audio));
+  let graph = Avfilter.launch config in
+  ( snd (List.hd Avfilter.(graph.inputs.audio)),
+    snd (List.hd Avfilter.(graph.outputs.audio)) )
+
+let push input n =
+  for i = 0 to n - 1 do
+    let frame =
+      Avutil.Audio.create_frame `Flt Avutil.Channel_layout.stereo rate
+        nb_samples
+    in
+    Avutil.Frame.set_pts frame (Some (Int64.of_int (i * nb_samples)));
+    input (`Frame frame)
+  done
+
+let status = function `Eagain -> "Eagain" | `Eof -> "Eof"
+
+let check_pts what frames =
+  Array.iteri
+    (fun i frame ->
+      let want = Some (Int64.of_int (i * nb_samples)) in
+      Test_assert.checkf
+        (Avutil.Frame.pts frame = want)
+        "%s: frame %d out of order" what i)
+    frames
+
+let () =
+  let input, output = graph () in
+  Test_assert.check "empty sink pulls `Eagain"
+    (output.Avfilter.pull () = `Eagain);
+
+  push input 5;
+  let frames, state = output.Avfilter.drain () in
+  Test_assert.checkf
+    (Array.length frames = 5)
+    "drain: %d frames, want 5" (Array.length frames);
+  Test_assert.checkf (state = `Eagain) "drain: %s, want Eagain"
+    (status state);
+  check_pts "drain" frames;
+
+  (* Frames passed as [~into] are refilled in place, extra output gets new
+     frames. *)
+  push input 12;
+  let into = Array.sub frames 0 3 in
+  let frames, _ = output.Avfilter.drain ~into () in
+  Test_assert.checkf
+    (Array.length frames = 12)
+    "drain ~into: %d frames, want 12" (Array.length frames);
+  Test_assert.check "drain ~into: reuses the given frames"
+    (Array.for_all2 ( == ) into (Array.sub frames 0 3));
+  check_pts "drain ~into" frames;
+
+  push input 1;
+  let into = frames.(0) in
+  (match output.Avfilter.pull ~into () with
+    | `Frame frame ->
+        Test_assert.check "pull ~into: reuses the given frame" (frame == into);
+        Test_assert.checkf
+          (Avutil.Audio.frame_nb_samples frame = nb_samples)
+          "pull ~into: %d samples" (Avutil.Audio.frame_nb_samples frame)
+    | `Eagain | `Eof -> Test_assert.check "pull ~into: no frame" false);
+  (match output.Avfilter.pull ~into () with
+    | `Eagain ->
+        Test_assert.check "pull ~into: left empty when nothing is pulled"
+          (Avutil.Audio.frame_nb_samples into = 0)
+    | _ -> Test_assert.check "pull ~into: empty sink pulls `Eagain" false);
+
+  push input 2;
+  (match output.Avfilter.drain ~into:[| into; into |] () with
+    | _ -> Test_assert.check "drain ~into: duplicates are rejected" false
+    | exception Avutil.Error _ ->
+        Test_assert.check "drain ~into: duplicates are rejected" true);
+  let frames, _ = output.Avfilter.drain () in
+  Test_assert.checkf
+    (Array.length frames = 2)
+    "drain ~into: rejected duplicates pull nothing, %d frames"
+    (Array.length frames);
+
+  push input 2;
+  input `Flush;
+  let frames, state = output.Avfilter.drain () in
+  Test_assert.checkf
+    (Array.length frames = 2 && state = `Eof)
+    "drain after flush: %d frames, %s" (Array.length frames) (status state);
+  Test_assert.check "pull after end of stream is `Eof"
+    (output.Avfilter.pull () = `Eof);
+
+  Test_assert.finish ()
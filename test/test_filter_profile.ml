@@ -0,0 +1,68 @@
+(* A profiled graph counts the frames pushed to its buffer source and pulled
+   from its sink, and the time spent in libavfilter doing so. *)
+
+let rate = 48000
+let nb_samples = 4096
+let nb_frames = 200
+
+let () =
+  let config = Avfilter.init ~profile:true () in
+  let args =
+    [
+      `Pair ("sample_rate", `Int rate);
+      `Pair ("time_base", `Rational { Avutil.num = 1; den = rate });
+      `Pair ("channel_layout", `String "stereo");
+      `Pair ("sample_fmt", `Int (Avutil.Sample_format.get_id `Flt));
+    ]
+  in
+  let src = Avfilter.(attach ~args ~name:"src" abuffer config) in
+  let volume =
+    Avfilter.attach
+      ~args:[`Pair ("volume", `Float 0.5)]
+      ~name:"volume" (Avfilter.find "volume") config
+  in
+  let sink = Avfilter.(attach ~name:"sink" abuffersink config) in
+  Avfilter.link
+    (List.hd Avfilter.(src.io.outputs.audio))
+    (List.hd Avfilter.(volume.io.inputs.audio));
+  Avfilter.link
+    (List.hd Avfilter.(volume.io.outputs.audio))
+    (List.hd Avfilter.(sink.io.inputs.audio));
+  let graph = Avfilter.launch config in
+  let input = snd (List.hd Avfilter.(graph.inputs.audio)) in
+  let source = snd (List.hd (Avfilter.sources config).audio) in
+  let output = snd (List.hd Avfilter.(graph.outputs.audio)) in
+
+  Test_assert.check "profile: nothing counted before any frame"
+    (List.for_all
+       (fun { Avfilter.io_frames; _ } -> io_frames = 0)
+       (Avfilter.profile config));
+
+  for i = 0 to nb_frames - 1 do
+    let frame =
+      Avutil.Audio.create_frame `Flt Avutil.Channel_layout.stereo rate
+        nb_samples
+    in
+    Avutil.Frame.set_pts frame (Some (Int64.of_int (i * nb_samples)));
+    (* Both the input function and [push] are counted. *)
+    if i mod 2 = 0 then input (`Frame frame) else Avfilter.push source frame;
+    ignore (output.Avfilter.drain ())
+  done;
+
+  let stats = Avfilter.profile config in
+  Test_assert.checkf
+    (List.length stats = 2)
+    "profile: %d entries, want 2" (List.length stats);
+  List.iter
+    (fun { Avfilter.io_name; io_source; io_frames; io_time; _ } ->
+      Test_assert.checkf
+        (io_source = (io_name = "src"))
+        "profile: %s is a %s" io_name
+        (if io_source then "source" else "sink");
+      Test_assert.checkf (io_frames = nb_frames)
+        "profile: %s counted %d frames, want %d" io_name io_frames nb_frames;
+      Test_assert.checkf (io_time > 0.) "profile: %s spent %f seconds"
+        io_name io_time)
+    stats;
+
+  Test_assert.finish ()
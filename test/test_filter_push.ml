@@ -0,0 +1,93 @@
+(* Frames pushed through a source come out whole, and by transfer leave the
+   pushed ones empty. Pushing before the graph is launched, or pushing an
+   empty frame, raises instead of reaching libavfilter. *)
+
+let rate = 48000
+let nb_samples = 512
+
+let make_frames n =
+  Array.init n (fun i ->
+      let frame =
+        Avutil.Audio.create_frame `Flt Avutil.Channel_layout.stereo rate
+          nb_samples
+      in
+      Avutil.Frame.set_pts frame (Some (Int64.of_int (i * nb_samples)));
+      frame)
+
+let check_pts what frames =
+  Array.iteri
+    (fun i frame ->
+      let want = Some (Int64.of_int (i * nb_samples)) in
+      Test_assert.checkf
+        (Avutil.Frame.pts frame = want)
+        "%s: frame %d out of order" what i)
+    frames
+
+let raises what f =
+  match f () with
+    | () -> Test_assert.check what false
+    | exception Avutil.Error _ -> Test_assert.check what true
+
+let () =
+  let config = Avfilter.init () in
+  let args =
+    [
+      `Pair ("sample_rate", `Int rate);
+      `Pair ("time_base", `Rational { Avutil.num = 1; den = rate });
+      `Pair ("channel_layout", `String "stereo");
+      `Pair ("sample_fmt", `Int (Avutil.Sample_format.get_id `Flt));
+    ]
+  in
+  let src = Avfilter.(attach ~args ~name:"src" abuffer config) in
+  let sink = Avfilter.(attach ~name:"sink" abuffersink config) in
+  Avfilter.link
+    (List.hd Avfilter.(src.io.outputs.audio))
+    (List.hd Avfilter.(sink.io.inputs.audio));
+  let source = snd (List.hd (Avfilter.sources config).audio) in
+
+  (match Avfilter.push source (make_frames 1).(0) with
+    | () -> Test_assert.check "push before launch raises" false
+    | exception Avutil.Error (`Failure _) ->
+        Test_assert.check "push before launch raises" true);
+
+  let graph = Avfilter.launch config in
+  let output = snd (List.hd Avfilter.(graph.outputs.audio)) in
+
+  let pushed = make_frames 4 in
+  Avfilter.push_all ~check_format:false ~transfer:true source pushed;
+  Test_assert.check "transfer: pushed frames are left empty"
+    (Array.for_all
+       (fun frame -> Avutil.Audio.frame_nb_samples frame = 0)
+       pushed);
+  let frames, _ = output.Avfilter.drain () in
+  Test_assert.checkf
+    (Array.length frames = 4)
+    "transfer: %d frames, want 4" (Array.length frames);
+  check_pts "transfer" frames;
+  Test_assert.check "transfer: samples come through"
+    (Array.for_all
+       (fun frame -> Avutil.Audio.frame_nb_samples frame = nb_samples)
+       frames);
+
+  raises "push of an emptied frame raises" (fun () ->
+      Avfilter.push ~check_format:false source pushed.(0));
+  raises "push_all with an emptied frame raises" (fun () ->
+      Avfilter.push_all source [| (make_frames 1).(0); pushed.(1) |]);
+  let frames, _ = output.Avfilter.drain () in
+  Test_assert.checkf
+    (Array.length frames = 0)
+    "push_all with an emptied frame pushes nothing, %d frames"
+    (Array.length frames);
+
+  let frame = (make_frames 1).(0) in
+  Avfilter.push source frame;
+  Test_assert.check "push keeps the frame by default"
+    (Avutil.Audio.frame_nb_samples frame = nb_samples);
+  (match output.Avfilter.pull () with
+    | `Frame frame ->
+        Test_assert.checkf
+          (Avutil.Audio.frame_nb_samples frame = nb_samples)
+          "push: %d samples" (Avutil.Audio.frame_nb_samples frame)
+    | `Eagain | `Eof -> Test_assert.check "push: no frame" false);
+
+  Test_assert.finish ()
@@ -0,0 +1,135 @@
+(* [Avfilter.reconfigure] rebuilds a graph around a new input format: the
+   filters and links stay, the sink negotiates the new format.
+   [Avfilter.Template] copies of a parsed graph each run on their own. *)
+
+let frame layout rate nb_samples =
+  Avutil.Audio.create_frame `Flt layout rate nb_samples
+
+let run (graph : Avfilter.t) frame =
+  let _, input = List.hd graph.inputs.audio in
+  let _, output = List.hd graph.outputs.audio in
+  input (`Frame frame);
+  let frames, _ = output.Avfilter.drain () in
+  (output.Avfilter.context, Array.length frames)
+
+let check what (context, nb_frames) ~channels ~rate =
+  Test_assert.checkf (nb_frames = 1) "%s: %d frames" what nb_frames;
+  Test_assert.checkf
+    (Avfilter.channels context = channels)
+    "%s: %d channels, want %d" what
+    (Avfilter.channels context)
+    channels;
+  Test_assert.checkf
+    (Avfilter.sample_rate context = rate)
+    "%s: %d Hz, want %d" what
+    (Avfilter.sample_rate context)
+    rate
+
+let args =
+  [
+    `Pair ("sample_rate", `Int 48000);
+    `Pair ("time_base", `Rational { Avutil.num = 1; den = 48000 });
+    `Pair ("channel_layout", `String "stereo");
+    `Pair ("sample_fmt", `Int (Avutil.Sample_format.get_id `Flt));
+  ]
+
+let node node_name node_pad = { Avfilter.node_name; node_args = None; node_pad }
+
+let parsed config =
+  let open Avfilter in
+  let src = attach ~args ~name:"src" abuffer config in
+  let sink = attach ~name:"sink" abuffersink config in
+  parse
+    {
+      inputs =
+        { audio = [node "out" (List.hd sink.io.inputs.audio)]; video = [] };
+      outputs =
+        { audio = [node "in" (List.hd src.io.outputs.audio)]; video = [] };
+    }
+    "[in]volume=0.5[out]" config
+
+let () =
+  let config = Avfilter.init () in
+  let src = Avfilter.(attach ~args ~name:"src" abuffer config) in
+  let volume =
+    Avfilter.attach
+      ~args:[`Pair ("volume", `Float 0.5)]
+      ~name:"volume" (Avfilter.find "volume") config
+  in
+  let sink = Avfilter.(attach ~name:"sink" abuffersink config) in
+  Avfilter.link
+    (List.hd Avfilter.(src.io.outputs.audio))
+    (List.hd Avfilter.(volume.io.inputs.audio));
+  Avfilter.link
+    (List.hd Avfilter.(volume.io.outputs.audio))
+    (List.hd Avfilter.(sink.io.inputs.audio));
+
+  let graph = Avfilter.launch config in
+  check "stereo"
+    (run graph (frame Avutil.Channel_layout.stereo 48000 256))
+    ~channels:2 ~rate:48000;
+
+  let stereo = graph in
+  let mono = frame Avutil.Channel_layout.mono 44100 256 in
+  let graph = Avfilter.reconfigure ~audio:[("src", mono)] config in
+  check "mono" (run graph mono) ~channels:1 ~rate:44100;
+
+  (* Filters from [attach] belong to the previous graph. *)
+  Test_assert.check "stale filter"
+    (try
+       ignore (Avfilter.process_command ~cmd:"volume" ~arg:"0.25" volume);
+       false
+     with Failure _ -> true);
+  let volume = Avfilter.attached_filter config "volume" in
+  ignore (Avfilter.process_command ~cmd:"volume" ~arg:"0.25" volume);
+  Test_assert.check "rebuilt filter"
+    (Avfilter.filter_nb_threads volume >= 1);
+  Test_assert.check "unknown filter"
+    (try
+       ignore (Avfilter.attached_filter config "nope");
+       false
+     with Not_found -> true);
+
+  (* The previous graph is only dropped once nothing obtained from it is
+     left. *)
+  Gc.full_major ();
+  check "stereo after reconfigure"
+    (run stereo (frame Avutil.Channel_layout.stereo 48000 256))
+    ~channels:2 ~rate:48000;
+
+  (* Parameters set once are kept. *)
+  let graph = Avfilter.reconfigure config in
+  check "mono again"
+    (run graph (frame Avutil.Channel_layout.mono 44100 256))
+    ~channels:1 ~rate:44100;
+
+  Test_assert.check "unknown input"
+    (try
+       ignore (Avfilter.reconfigure ~audio:[("nope", mono)] config);
+       false
+     with Not_found -> true);
+
+  let template = Avfilter.Template.create parsed in
+  Avfilter.Template.prepare template 2;
+  Test_assert.checkf
+    (Avfilter.Template.prepared template = 2)
+    "template: %d prepared" (Avfilter.Template.prepared template);
+  let instances =
+    List.init 3 (fun _ -> Avfilter.Template.instantiate template)
+  in
+  Test_assert.checkf
+    (Avfilter.Template.prepared template = 0)
+    "template: %d left" (Avfilter.Template.prepared template);
+  List.iteri
+    (fun i (_, graph) ->
+      check
+        (Printf.sprintf "template copy %d" i)
+        (run graph (frame Avutil.Channel_layout.stereo 48000 256))
+        ~channels:2 ~rate:48000)
+    instances;
+  Test_assert.check "template: copies are distinct graphs"
+    (match instances with
+      | (a, _) :: (b, _) :: _ -> a != b
+      | _ -> false);
+
+  Test_assert.finish ()
@@ -0,0 +1,51 @@
+(* Graph and per-filter threading: the graph keeps the pool size it was asked
+   for, and a filter never runs on more threads than it is allowed. *)
+
+let slice_threaded =
+  List.filter
+    (fun { Avfilter.flags; _ } -> List.mem `Slice_threads flags)
+    Avfilter.filters
+
+let count = ref 0
+
+(* Not every filter initialises without arguments: use the first that does. *)
+let attach ?nb_threads ?thread_type config =
+  let rec attach = function
+    | [] -> None
+    | filter :: filters -> (
+        incr count;
+        let name = Printf.sprintf "f%d" !count in
+        try Some (Avfilter.attach ?nb_threads ?thread_type ~name filter config)
+        with Avutil.Error _ -> attach filters)
+  in
+  attach slice_threaded
+
+let check what ?nb_threads ?thread_type config ~max =
+  match attach ?nb_threads ?thread_type config with
+    | None -> ()
+    | Some filter ->
+        let n = Avfilter.filter_nb_threads filter in
+        Test_assert.checkf
+          (n >= 1 && n <= max)
+          "%s: %s runs on %d threads, want 1 to %d" what filter.Avfilter.name
+          n max
+
+let () =
+  let config = Avfilter.init ~nb_threads:3 () in
+  Test_assert.checkf
+    (Avfilter.nb_threads config = 3)
+    "requested pool: %d threads" (Avfilter.nb_threads config);
+  check "graph" config ~max:3;
+  check "capped" ~nb_threads:2 config ~max:2;
+  check "no slices" ~thread_type:`None config ~max:1;
+
+  let config = Avfilter.init ~thread_type:`None () in
+  check "graph without slices" config ~max:1;
+
+  let config = Avfilter.init ~nb_threads:1 () in
+  ignore (Avfilter.attach ~name:"sink" Avfilter.abuffersink config);
+  Test_assert.checkf
+    (Avfilter.nb_threads config = 1)
+    "single thread: %d threads" (Avfilter.nb_threads config);
+
+  Test_assert.finish ()
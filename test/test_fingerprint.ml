@@ -0,0 +1,117 @@
+(* [Avutil.Frame.fingerprint] only depends on visible content, palette
+   included, and [Avutil.Frame.perceptual_hash] barely moves on small
+   changes. *)
+
+open Avutil
+
+let w = 64
+let h = 48
+
+(* A horizontal gradient, with [linesize] bytes per line and padding set to
+   [padding]. *)
+let gradient ?(flip = false) ~linesize ~padding () =
+  let plane ~w ~h ~linesize value =
+    let data = create_data (linesize * h) in
+    Bigarray.Array1.fill data padding;
+    for y = 0 to h - 1 do
+      for x = 0 to w - 1 do
+        data.{(y * linesize) + x} <- value x
+      done
+    done;
+    (data, linesize)
+  in
+  Video.frame_of_bigarrays w h `Yuv420p
+    [|
+      plane ~w ~h ~linesize (fun x ->
+          let x = if flip then w - 1 - x else x in
+          16 + (x * 3));
+      plane ~w:(w / 2) ~h:(h / 2) ~linesize:(linesize / 2) (fun _ -> 128);
+      plane ~w:(w / 2) ~h:(h / 2) ~linesize:(linesize / 2) (fun _ -> 128);
+    |]
+
+let () =
+  let a = gradient ~linesize:64 ~padding:0 () in
+  let b = gradient ~linesize:128 ~padding:0xff () in
+  Test_assert.check "padding is ignored"
+    (Frame.fingerprint a = Frame.fingerprint b);
+
+  let luma, _ = (Video.frame_planes ~make_writable:true b).(0) in
+  luma.{(10 * 128) + 10} <- luma.{(10 * 128) + 10} + 2;
+  Test_assert.check "content changes the fingerprint"
+    (Frame.fingerprint a <> Frame.fingerprint b);
+
+  let distance x y =
+    Frame.hash_distance (Frame.perceptual_hash x) (Frame.perceptual_hash y)
+  in
+  Test_assert.checkf (distance a b <= 2) "close frames: distance %d"
+    (distance a b);
+  let c = gradient ~flip:true ~linesize:64 ~padding:0 () in
+  Test_assert.checkf (distance a c >= 32) "flipped frames: distance %d"
+    (distance a c);
+
+  let audio value =
+    let frame = Audio.create_frame `S16 Channel_layout.stereo 48000 1024 in
+    let plane =
+      (Audio.frame_planes ~make_writable:true Bigarray.int16_signed frame).(0)
+    in
+    for i = 0 to Bigarray.Array1.dim plane - 1 do
+      plane.{i} <- value (i / 2)
+    done;
+    frame
+  in
+  let ramp i = i * 16 in
+  let a = audio ramp and b = audio ramp in
+  Test_assert.check "audio fingerprint"
+    (Frame.fingerprint a = Frame.fingerprint b);
+  Test_assert.check "audio perceptual hash"
+    (Frame.perceptual_hash a = Frame.perceptual_hash b);
+  Test_assert.checkf
+    (distance a (audio (fun i -> ramp (1023 - i))) >= 32)
+    "reversed audio: distance %d"
+    (distance a (audio (fun i -> ramp (1023 - i))));
+
+  (* Palette frames: same indices, different colours. *)
+  let pal8 colour =
+    let frame = Video.create_frame 16 16 `Pal8 in
+    let indices, _ = (Video.frame_planes ~make_writable:true frame).(0) in
+    Bigarray.Array1.fill indices 1;
+    let palette = Video.frame_palette ~make_writable:true frame in
+    Bigarray.Array1.fill palette 0;
+    palette.{4} <- colour;
+    frame
+  in
+  Test_assert.check "same palette, same fingerprint"
+    (Frame.fingerprint (pal8 0x10) = Frame.fingerprint (pal8 0x10));
+  Test_assert.check "palette changes the fingerprint"
+    (Frame.fingerprint (pal8 0x10) <> Frame.fingerprint (pal8 0xf0));
+
+  (* The perceptual hash of a palette frame follows the colours its indices
+     point to. Entries are red and green whichever the byte order, with no
+     blue. *)
+  let pal8_gradient ~flip =
+    let frame = Video.create_frame w h `Pal8 in
+    let palette = Video.frame_palette ~make_writable:true frame in
+    Bigarray.Array1.fill palette 0;
+    for i = 0 to 255 do
+      palette.{(4 * i) + 1} <- i;
+      palette.{(4 * i) + 2} <- i
+    done;
+    let indices, linesize =
+      (Video.frame_planes ~make_writable:true frame).(0)
+    in
+    for y = 0 to h - 1 do
+      for x = 0 to w - 1 do
+        let index = if flip then w - 1 - x else x in
+        indices.{(y * linesize) + x} <- index * 4
+      done
+    done;
+    frame
+  in
+  let a = pal8_gradient ~flip:false and b = pal8_gradient ~flip:false in
+  Test_assert.check "palette perceptual hash"
+    (Frame.perceptual_hash a = Frame.perceptual_hash b);
+  let c = pal8_gradient ~flip:true in
+  Test_assert.checkf (distance a c >= 32) "flipped palette frames: distance %d"
+    (distance a c);
+
+  Test_assert.finish ()
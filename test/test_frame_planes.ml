@@ -0,0 +1,75 @@
+(* Plane views from [frame_planes]: writes through a view land in the frame,
+   views outlive their frame, chroma planes are sized to the plane and the
+   element kind must match the sample format. *)
+
+open Avutil
+
+let rate = 48000
+let stereo = Channel_layout.stereo
+
+let () =
+  let frame = Audio.create_frame `S16 stereo rate 1000 in
+  let plane =
+    (Audio.frame_planes ~make_writable:true Bigarray.int16_signed frame).(0)
+  in
+  Test_assert.checkf
+    (Bigarray.Array1.dim plane = 2000)
+    "interleaved: %d samples, want 2000" (Bigarray.Array1.dim plane);
+  for i = 0 to Bigarray.Array1.dim plane - 1 do
+    plane.{i} <- i / 2
+  done;
+  let plane = (Audio.frame_planes Bigarray.int16_signed frame).(0) in
+  let bad = ref 0 in
+  for i = 0 to Bigarray.Array1.dim plane - 1 do
+    if plane.{i} <> i / 2 then incr bad
+  done;
+  Test_assert.checkf (!bad = 0) "content: %d samples out of place" !bad;
+
+  let frame = Audio.create_frame `Fltp stereo rate 16 in
+  let planes = Audio.frame_planes Bigarray.float32 frame in
+  Test_assert.checkf
+    (Array.length planes = 2)
+    "planar: %d planes, want 2" (Array.length planes);
+
+  (* Views outlive their frame, sub-arrays included. *)
+  let plane =
+    let frame = Audio.create_frame `Flt stereo rate 256 in
+    let plane =
+      (Audio.frame_planes ~make_writable:true Bigarray.float32 frame).(0)
+    in
+    Bigarray.Array1.fill plane 0.5;
+    Bigarray.Array1.sub plane 16 32
+  in
+  Gc.full_major ();
+  Test_assert.check "view outlives frame" (plane.{31} = 0.5);
+
+  Test_assert.check "mismatched kind is rejected"
+    (try
+       ignore
+         (Audio.frame_planes Bigarray.float64
+            (Audio.create_frame `Flt stereo rate 16));
+       false
+     with Error _ -> true);
+
+  (* Chroma planes are a quarter of the luma plane, not linesize * height. *)
+  let planes = Video.frame_planes (Video.create_frame 64 48 `Yuv420p) in
+  Array.iteri
+    (fun i (data, linesize) ->
+      let height = if i = 0 then 48 else 24 in
+      Test_assert.checkf
+        (Bigarray.Array1.dim data >= linesize * (height - 1))
+        "video plane %d: %d bytes for %d lines of %d" i
+        (Bigarray.Array1.dim data) height linesize;
+      Test_assert.checkf
+        (Bigarray.Array1.dim data <= linesize * height)
+        "video plane %d: %d bytes, past %d lines of %d" i
+        (Bigarray.Array1.dim data) height linesize)
+    planes;
+
+  Test_assert.check "views cannot be compared"
+    (try
+       ignore (compare (fst planes.(0)) (fst planes.(1)));
+       false
+     with Invalid_argument _ -> true);
+
+  Test_assert.finish ()
@@ -0,0 +1,105 @@
+(* Frames drawn from an [Avutil.Frame_pool] must look exactly like freshly
+   allocated ones, including across shape changes that evict a shape, and
+   released buffers must be handed out again. *)
+
+open Avutil
+
+let check_video pool w h pixel_format =
+  let frame = Video.create_frame ~pool w h pixel_format in
+  let planes = Video.frame_planes ~make_writable:true frame in
+  let expected =
+    Array.length (Video.frame_planes (Video.create_frame w h pixel_format))
+  in
+  Test_assert.checkf
+    (Array.length planes = expected)
+    "%dx%d: %d planes, want %d" w h (Array.length planes) expected;
+  Array.iteri
+    (fun i (data, linesize) ->
+      let rows = if i = 0 then h else (h + 1) / 2 in
+      Test_assert.checkf
+        (linesize >= w / (if i = 0 then 1 else 2)
+        && Bigarray.Array1.dim data >= linesize * rows)
+        "%dx%d plane %d: %d bytes, linesize %d" w h i (Bigarray.Array1.dim data)
+        linesize;
+      Bigarray.Array1.fill data 0x80)
+    planes
+
+let check_audio pool sample_format nb_samples =
+  let frame =
+    Audio.create_frame ~pool sample_format Channel_layout.stereo 48000
+      nb_samples
+  in
+  let planes = Audio.frame_planes ~make_writable:true Bigarray.float32 frame in
+  Test_assert.checkf
+    (Audio.frame_nb_samples frame = nb_samples)
+    "audio: %d samples" (Audio.frame_nb_samples frame);
+  Array.iter
+    (fun plane ->
+      let want = if sample_format = `Fltp then nb_samples else 2 * nb_samples in
+      Test_assert.checkf
+        (Bigarray.Array1.dim plane = want)
+        "audio plane: %d samples, want %d" (Bigarray.Array1.dim plane) want;
+      Bigarray.Array1.fill plane 0.25)
+    planes
+
+let () =
+  let pool = Frame_pool.create ~max_shapes:2 () in
+  for _ = 1 to 4 do
+    check_video pool 320 240 `Yuv420p;
+    check_video pool 33 17 `Yuv420p;
+    check_video pool 64 48 `Rgb24;
+    Gc.full_major ()
+  done;
+
+  let pool = Frame_pool.create () in
+  for _ = 1 to 4 do
+    check_audio pool `Fltp 1024;
+    check_audio pool `Flt 1024;
+    check_audio pool `Fltp 100;
+    Gc.full_major ()
+  done;
+
+  (* Every shape allocated its buffers once, then reused them. *)
+  let pool = Frame_pool.create () in
+  let allocated = ref 0 in
+  for round = 1 to 4 do
+    check_video pool 320 240 `Yuv420p;
+    check_audio pool `Fltp 1024;
+    Gc.full_major ();
+    if round = 1 then allocated := Frame_pool.allocated pool
+  done;
+  Test_assert.checkf (!allocated = 3) "first round: %d buffers, want 3"
+    !allocated;
+  Test_assert.checkf
+    (Frame_pool.allocated pool = !allocated)
+    "reuse: %d buffers allocated, want %d" (Frame_pool.allocated pool)
+    !allocated;
+
+  (* A frame still alive keeps its buffer. *)
+  let frame = Video.create_frame ~pool 320 240 `Yuv420p in
+  ignore (Video.create_frame ~pool 320 240 `Yuv420p);
+  Test_assert.checkf
+    (Frame_pool.allocated pool = !allocated + 1)
+    "held frame: %d buffers allocated, want %d" (Frame_pool.allocated pool)
+    (!allocated + 1);
+  ignore (Sys.opaque_identity frame);
+
+  (* Past 8 planes, buffers go in extended_buf and are pooled all the same. *)
+  let layout = Channel_layout.get_default 16 in
+  let pool = Frame_pool.create () in
+  for _ = 1 to 2 do
+    let frame = Audio.create_frame ~pool `Fltp layout 48000 256 in
+    let planes =
+      Audio.frame_planes ~make_writable:true Bigarray.float32 frame
+    in
+    Test_assert.checkf
+      (Array.length planes = 16)
+      "16 channels: %d planes" (Array.length planes);
+    Array.iter (fun plane -> Bigarray.Array1.fill plane 0.25) planes;
+    Gc.full_major ()
+  done;
+  Test_assert.checkf
+    (Frame_pool.allocated pool = 16)
+    "16 channels: %d buffers allocated, want 16" (Frame_pool.allocated pool);
+
+  Test_assert.finish ()
@@ -0,0 +1,110 @@
+(* [Avutil.Shm_frame]: frames mapped back from their descriptor, here or
+   after a trip through a Unix socket, share their data with the original
+   one. Their size cannot change under a mapping. *)
+
+open Avutil
+
+let fill frame value =
+  Array.iter
+    (fun (data, _) -> Bigarray.Array1.fill data value)
+    (Video.frame_planes ~make_writable:true frame)
+
+let check_planes what frame value =
+  Array.iteri
+    (fun i (data, _) ->
+      Test_assert.checkf
+        (data.{0} = value && data.{Bigarray.Array1.dim data - 1} = value)
+        "%s: plane %d" what i)
+    (Video.frame_planes frame)
+
+let () =
+  match Shm_frame.create_video 320 240 `Yuv420p with
+    | exception Error _ ->
+        (* Not supported on this platform. *)
+        Test_assert.finish ()
+    | frame ->
+        fill frame 0x42;
+        Frame.set_pts frame (Some 1234L);
+
+        let descriptor = Shm_frame.descriptor frame in
+        let mapped = Shm_frame.video_frame descriptor in
+        Unix.close descriptor.fd;
+        check_planes "mapped" mapped 0x42;
+        Test_assert.check "mapped pts" (Frame.pts mapped = Some 1234L);
+
+        (* A live view holds a reference on the mapping: making [mapped]
+           writable must not copy it away from [frame] all the same. *)
+        let view, _ = (Video.frame_planes mapped).(0) in
+        fill mapped 0x24;
+        check_planes "written through" frame 0x24;
+        Test_assert.check "written through, earlier view"
+          (view.{0} = 0x24);
+
+        let a, b = Unix.socketpair Unix.PF_UNIX Unix.SOCK_STREAM 0 in
+        let descriptor = Shm_frame.descriptor mapped in
+        Shm_frame.send a descriptor;
+        Unix.close descriptor.fd;
+        let received = Shm_frame.receive b in
+        let video = Shm_frame.video_frame received in
+        Unix.close received.fd;
+        check_planes "received" video 0x24;
+
+        Test_assert.check "wrong media type is rejected"
+          (try
+             ignore (Shm_frame.audio_frame (Shm_frame.descriptor video));
+             false
+           with Error _ -> true);
+
+        (* Sizes are sealed, and unsealed files are not mapped. *)
+        let descriptor = Shm_frame.descriptor video in
+        Test_assert.check "size is sealed"
+          (try
+             Unix.ftruncate descriptor.fd 0;
+             false
+           with Unix.Unix_error (Unix.EPERM, _, _) -> true);
+        let file = Filename.temp_file "shm_frame" ".raw" in
+        let fd = Unix.openfile file [Unix.O_RDWR] 0o600 in
+        Unix.ftruncate fd (1 lsl 20);
+        Sys.remove file;
+        Test_assert.check "unsealed file is rejected"
+          (try
+             ignore (Shm_frame.video_frame { descriptor with fd });
+             false
+           with Error _ -> true);
+        Unix.close fd;
+        Unix.close descriptor.fd;
+
+        Test_assert.check "regular frames are rejected"
+          (try
+             ignore
+               (Shm_frame.descriptor (Video.create_frame 16 16 `Yuv420p));
+             false
+           with Error _ -> true);
+
+        let audio =
+          Shm_frame.create_audio `Fltp Channel_layout.stereo 48000 1024
+        in
+        Array.iter
+          (fun plane -> Bigarray.Array1.fill plane 0.5)
+          (Audio.frame_planes ~make_writable:true Bigarray.float32 audio);
+        Unix.close a;
+        let descriptor = Shm_frame.descriptor audio in
+        let mapped = Shm_frame.audio_frame descriptor in
+        Unix.close descriptor.fd;
+        Test_assert.checkf
+          (Audio.frame_nb_samples mapped = 1024
+          && Audio.frame_get_channels mapped = 2)
+          "audio: %d samples, %d channels"
+          (Audio.frame_nb_samples mapped)
+          (Audio.frame_get_channels mapped);
+        Array.iter
+          (fun plane -> Test_assert.check "audio samples" (plane.{1023} = 0.5))
+          (Audio.frame_planes Bigarray.float32 mapped);
+
+        Test_assert.check "closed socket"
+          (try
+             ignore (Shm_frame.receive b);
+             false
+           with End_of_file -> true);
+
+        Test_assert.finish ()
@@ -131,5 +131,117 @@ let () =
     (Avutil.Audio.frame_nb_samples frame)
     expected;
 
+  (* convert_into: the same ramp, written into reused outputs. *)
+  let ctx = ToFloatArray.create mono rate mono rate in
+  let out = Array.make (nb_samples + 16) nan in
+  let n = ToFloatArray.convert_into ctx ramp out in
+  Test_assert.checkf (n = nb_samples) "FloatArray into: %d samples" n;
+  check_ramp "FloatArray into" (Array.sub out 0 n);
+
+  let ctx = ToBigArray.create mono rate mono rate in
+  let out = Bigarray.Array1.create Bigarray.float64 Bigarray.c_layout 512 in
+  let n = ToBigArray.convert_into ctx ramp out in
+  Test_assert.checkf (n = 512) "DblBigArray into: %d samples, want 512" n;
+  (* What did not fit comes out next. *)
+  let rest = ToBigArray.convert_into ctx [||] out in
+  Test_assert.checkf (n + rest = nb_samples) "DblBigArray into: %d + %d" n rest;
+
+  let ctx = ToBytes.create mono rate mono rate in
+  let out = Bytes.make (8 * nb_samples) '\000' in
+  let n = ToBytes.convert_into ctx ramp out in
+  check_ramp "DblBytes into" (Array.sub (bytes_to_floats out) 0 n);
+
+  let ctx = ToFrame.create mono rate mono half in
+  let out = Avutil.Audio.create_frame `Dbl mono half nb_samples in
+  for _ = 1 to 2 do
+    let n = ToFrame.convert_into ctx ramp out in
+    Test_assert.checkf
+      (near n && Avutil.Audio.frame_nb_samples out = n)
+      "DblFrame into: %d samples, frame has %d" n
+      (Avutil.Audio.frame_nb_samples out)
+  done;
+  Test_assert.check "DblFrame into: mismatched frame is rejected"
+    (try
+       ignore
+         (ToFrame.convert_into ctx ramp
+            (Avutil.Audio.create_frame `Flt mono half nb_samples));
+       false
+     with Avutil.Error _ -> true);
+
+  (* NaNs come out as silence, offsets count samples per channel. *)
+  let stereo = Avutil.Channel_layout.stereo in
+  let ctx = ToFloatArray.create stereo rate stereo rate in
+  let input = Array.init (2 * nb_samples) (fun i -> ramp.(i / 2)) in
+  input.(2 * 100) <- Float.nan;
+  let out = ToFloatArray.convert ~offset:10 ctx input in
+  Test_assert.checkf
+    (Array.length out = 2 * (nb_samples - 10))
+    "stereo offset: %d samples" (Array.length out);
+  check_ramp "stereo offset"
+    (Array.init nb_samples (fun i ->
+         if i < 10 then ramp.(i)
+         else if i = 100 then ramp.(100)
+         else out.(2 * (i - 10))));
+  Test_assert.checkf (out.(2 * 90) = 0.) "stereo NaN: %f" out.(2 * 90);
+
+  (* Drift compensation: 1% more output over the next 1000 samples. *)
+  let ctx = ToBigArray.create mono rate mono rate in
+  ToBigArray.set_compensation ctx ~delta:10 ~distance:1000;
+  let got = ref 0 in
+  for _ = 1 to 4 do
+    got := !got + Bigarray.Array1.dim (ToBigArray.convert ctx ramp)
+  done;
+  let delay = Int64.to_int (ToBigArray.get_delay ctx rate) in
+  Test_assert.checkf
+    (abs (!got + delay - (4 * nb_samples) - 10) <= 4)
+    "compensation: %d samples out, %d delayed, for %d in" !got delay
+    (4 * nb_samples);
+  Test_assert.check "next_pts"
+    (ToBigArray.next_pts ctx Int64.min_int >= 0L);
+
+  (* Batches: each stream keeps its own context. *)
+  let ctxs = Array.init 64 (fun _ -> ToBigArray.create mono rate mono rate) in
+  let inputs =
+    Array.init 64 (fun k -> Array.map (fun v -> v *. float k /. 64.) ramp)
+  in
+  let outs =
+    ToBigArray.convert_all (Array.map2 (fun c i -> (c, i)) ctxs inputs)
+  in
+  let bad = ref 0 in
+  Array.iteri
+    (fun k out ->
+      let got = ba_to_floats out in
+      if
+        Array.length got <> nb_samples
+        || not (Array.for_all2 close_enough got inputs.(k))
+      then incr bad)
+    outs;
+  Test_assert.checkf (!bad = 0) "convert_all: %d streams wrong" !bad;
+  Test_assert.check "convert_all: shared context is rejected"
+    (try
+       ignore (ToBigArray.convert_all [| (ctxs.(0), ramp); (ctxs.(0), ramp) |]);
+       false
+     with Avutil.Error _ -> true);
+
+  (* The workers do not survive fork: the child must start its own. *)
+  (match Unix.fork () with
+    | 0 ->
+        let ctxs =
+          Array.init 4 (fun _ -> ToBigArray.create mono rate mono rate)
+        in
+        let outs =
+          ToBigArray.convert_all (Array.map (fun c -> (c, ramp)) ctxs)
+        in
+        Unix._exit
+          (if
+             Array.for_all
+               (fun out -> Bigarray.Array1.dim out = nb_samples)
+               outs
+           then 0
+           else 1)
+    | pid ->
+        Test_assert.check "convert_all after fork"
+          (snd (Unix.waitpid [] pid) = Unix.WEXITED 0));
+
   Gc.full_major ();
   Test_assert.finish ()
@@ -1,8 +1,14 @@
 (* Plane sizing on the string output path: sizing a plane by stride * height
    ignores chroma subsampling and hands back U and V at twice their real
-   length. *)
+   length. Then [convert_into], with outputs reused across calls, and threaded
+   conversions, which must match single-threaded ones, and contexts
+   evicted by [Cache] once it is full. Slices must add up to a full
+   conversion, into frames and bigarrays, and share their planes. *)
 
 module Convert = Swscale.Make (Swscale.Bytes) (Swscale.Bytes)
+module Frame_convert = Swscale.Make (Swscale.Frame) (Swscale.Frame)
+module Ba_convert = Swscale.Make (Swscale.BigArray) (Swscale.BigArray)
+module Frame_ba_convert = Swscale.Make (Swscale.Frame) (Swscale.BigArray)
 
 let () =
   let w = 64 and h = 64 in
@@ -29,5 +35,177 @@ let () =
       (w * h / 4)
   done;
 
+  let src = Avutil.Video.create_frame w h `Rgb24 in
+  Array.iter
+    (fun (data, _) -> Bigarray.Array1.fill data 0xff)
+    (Avutil.Video.frame_planes ~make_writable:true src);
+  let ctx = Frame_convert.create [Swscale.Bilinear] w h `Rgb24 w h `Gray8 in
+  let dst = Avutil.Video.create_frame w h `Gray8 in
+  Frame_convert.convert_into ctx src dst;
+  let data, _ = (Avutil.Video.frame_planes dst).(0) in
+  Test_assert.checkf (data.{0} >= 0xe0) "frame: white is %d" data.{0};
+  Test_assert.check "frame: mismatched output is rejected"
+    (try
+       Frame_convert.convert_into ctx src
+         (Avutil.Video.create_frame (w / 2) h `Gray8);
+       false
+     with Avutil.Error _ -> true);
+
+  let ctx = Ba_convert.create [Swscale.Bilinear] w h `Gray8 w h `Gray8 in
+  let src = Avutil.create_data (w * h) in
+  Bigarray.Array1.fill src 0x42;
+  (* Padded lines. *)
+  let dst = Avutil.create_data ((2 * w * h) + 16) in
+  Ba_convert.convert_into ctx [| (src, w) |] [| (dst, 2 * w) |];
+  Test_assert.checkf
+    (dst.{(2 * w) + 1} = 0x42)
+    "bigarray: %d" dst.{(2 * w) + 1};
+  Test_assert.check "bigarray: short output is rejected"
+    (try
+       Ba_convert.convert_into ctx [| (src, w) |] [| (dst, 4 * w) |];
+       false
+     with Avutil.Error _ -> true);
+  Test_assert.check "bigarray: unpadded output is rejected"
+    (try
+       Ba_convert.convert_into ctx
+         [| (src, w) |]
+         [| (Avutil.create_data (w * h), w) |];
+       false
+     with Avutil.Error _ -> true);
+
+  let w = 256 and h = 144 in
+  let src = Avutil.Video.create_frame w h `Yuv420p in
+  Array.iteri
+    (fun i (data, linesize) ->
+      for j = 0 to Bigarray.Array1.dim data - 1 do
+        data.{j} <-
+          ((j mod linesize) + (3 * (j / linesize)) + (17 * i)) land 0xff
+      done)
+    (Avutil.Video.frame_planes ~make_writable:true src);
+  let convert threads =
+    let ctx =
+      Frame_convert.create ~threads [Swscale.Bicubic] w h `Yuv420p (w / 4)
+        (h / 4) `Yuv420p
+    in
+    Frame_convert.convert ctx src
+  in
+  let single = convert 1 and threaded = convert 4 in
+  Array.iteri
+    (fun i (data, linesize) ->
+      let data', linesize' = (Avutil.Video.frame_planes threaded).(i) in
+      let rows = if i = 0 then h / 4 else h / 8 in
+      let width = if i = 0 then w / 4 else w / 8 in
+      let bad = ref 0 in
+      for y = 0 to rows - 1 do
+        for x = 0 to width - 1 do
+          if data.{(y * linesize) + x} <> data'.{(y * linesize') + x} then
+            incr bad
+        done
+      done;
+      Test_assert.checkf (!bad = 0) "threads: plane %d, %d pixels differ" i
+        !bad)
+    (Avutil.Video.frame_planes single);
+
+  let cache = Ba_convert.Cache.create ~capacity:2 () in
+  let get w h =
+    Ba_convert.Cache.get cache [] w h `Gray8 (w / 2) (h / 2) `Gray8
+  in
+  let a = get 64 64 in
+  Test_assert.check "cache: hit" (get 64 64 == a);
+  let b = get 32 32 in
+  ignore (get 64 64);
+  let check_scale what ctx size =
+    let src = Avutil.create_data (size * size) in
+    Bigarray.Array1.fill src 0x42;
+    let data, linesize = (Ba_convert.convert ctx [| (src, size) |]).(0) in
+    let last = ((size / 2) - 1) * (linesize + 1) in
+    Test_assert.checkf
+      (linesize >= size / 2
+      && Bigarray.Array1.dim data > last
+      && data.{last} = 0x42)
+      "cache: %s output, linesize %d" what linesize
+  in
+  (* Evicts [b], the least recently used, which its holder can still use. *)
+  let c = get 16 16 in
+  Test_assert.check "cache: lru evicted" (c != b && get 64 64 == a);
+  Test_assert.checkf
+    (Ba_convert.Cache.length cache = 2)
+    "cache: %d contexts" (Ba_convert.Cache.length cache);
+  check_scale "new" c 16;
+  check_scale "evicted" b 32;
+  Test_assert.check "cache: evicted context is not handed out again"
+    (get 32 32 != b);
+
+  let ctx =
+    Frame_convert.create [Swscale.Bicubic] w h `Yuv420p (w / 4) (h / 4)
+      `Yuv420p
+  in
+  let dst = Avutil.Video.create_frame (w / 4) (h / 4) `Yuv420p in
+  let rows = ref 0 in
+  let y = ref 0 in
+  while !y < h do
+    let slice_h = min 16 (h - !y) in
+    let out_y, out_h = Frame_convert.send_slice ctx ~y:!y ~h:slice_h src dst in
+    Test_assert.checkf (out_y = !rows) "slices: rows from %d, want %d" out_y
+      !rows;
+    rows := !rows + out_h;
+    y := !y + slice_h
+  done;
+  Test_assert.checkf (!rows = h / 4) "slices: %d rows, want %d" !rows (h / 4);
+  let data, linesize = (Avutil.Video.frame_planes single).(0) in
+  let data', linesize' = (Avutil.Video.frame_planes dst).(0) in
+  let bad = ref 0 in
+  for y = 0 to (h / 4) - 1 do
+    for x = 0 to (w / 4) - 1 do
+      if data.{(y * linesize) + x} <> data'.{(y * linesize') + x} then incr bad
+    done
+  done;
+  Test_assert.checkf (!bad = 0) "slices: %d pixels differ" !bad;
+  Test_assert.check "slices: out of order slice is rejected"
+    (try
+       ignore (Frame_convert.send_slice ctx ~y:32 ~h:16 src dst);
+       false
+     with Avutil.Error _ -> true);
+
+  (* Bigarray outputs, with a collection between slices and a stray output
+     in the middle of the picture. *)
+  let ctx =
+    Frame_ba_convert.create [Swscale.Bicubic] w h `Yuv420p (w / 4) (h / 4)
+      `Yuv420p
+  in
+  let planes () =
+    let plane w h = (Avutil.create_data ((w * h) + 16), w) in
+    [| plane (w / 4) (h / 4); plane (w / 8) (h / 8); plane (w / 8) (h / 8) |]
+  in
+  let dst = planes () in
+  let rows = ref 0 in
+  let y = ref 0 in
+  while !y < h do
+    let slice_h = min 16 (h - !y) in
+    if !y = 16 then begin
+      Gc.full_major ();
+      Test_assert.check "bigarray slices: other output is rejected"
+        (try
+           ignore
+             (Frame_ba_convert.send_slice ctx ~y:!y ~h:slice_h src (planes ()));
+           false
+         with Avutil.Error _ -> true)
+    end;
+    let _, out_h = Frame_ba_convert.send_slice ctx ~y:!y ~h:slice_h src dst in
+    rows := !rows + out_h;
+    y := !y + slice_h
+  done;
+  Test_assert.checkf (!rows = h / 4) "bigarray slices: %d rows, want %d" !rows
+    (h / 4);
+  let data, linesize = (Avutil.Video.frame_planes single).(0) in
+  let data', linesize' = dst.(0) in
+  let bad = ref 0 in
+  for y = 0 to (h / 4) - 1 do
+    for x = 0 to (w / 4) - 1 do
+      if data.{(y * linesize) + x} <> data'.{(y * linesize') + x} then incr bad
+    done
+  done;
+  Test_assert.checkf (!bad = 0) "bigarray slices: %d pixels differ" !bad;
+
   Gc.full_major ();
   Test_assert.finish ()